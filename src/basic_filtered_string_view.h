@@ -0,0 +1,247 @@
+#ifndef COMP6771_ASS2_BASIC_FSV_H
+#define COMP6771_ASS2_BASIC_FSV_H
+
+#include <algorithm>
+#include <compare>
+#include <concepts>
+#include <cstring>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#include "./filtered_string_view.h"
+
+namespace fsv {
+    /**
+        filtered_string_view whose predicate type is part of the view type, so the predicate is
+        stored by value and every character test can be inlined. Converts implicitly to the
+        type-erased filtered_string_view.
+    */
+    template<typename Pred = detail::accept_all>
+    class basic_filtered_string_view {
+        static_assert(std::predicate<const Pred&, const char&>, "Pred must be callable as bool(const char&)");
+
+        class iter {
+        public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = char;
+            using difference_type = std::ptrdiff_t;
+            using reference = const char&;
+            using pointer = const char*;
+
+            iter() = default;
+
+            auto operator*() const noexcept -> reference {
+                return view_->pointer_[pos_];
+            }
+
+            auto operator->() const noexcept -> pointer {
+                return view_->pointer_ + pos_;
+            }
+
+            auto operator++() -> iter& {
+                pos_ = view_->first_valid(pos_ + 1);
+                return *this;
+            }
+
+            auto operator++(int) -> iter {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            auto operator--() -> iter& {
+                do {
+                    --pos_;
+                } while (pos_ > 0 && !view_->predicate_(view_->pointer_[pos_]));
+                return *this;
+            }
+
+            auto operator--(int) -> iter {
+                auto copy = *this;
+                --*this;
+                return copy;
+            }
+
+            friend auto operator==(const iter& a, const iter& b) noexcept -> bool {
+                return a.view_ == b.view_ && a.pos_ == b.pos_;
+            }
+
+        private:
+            friend class basic_filtered_string_view;
+            iter(const basic_filtered_string_view* view, std::size_t pos) noexcept
+            : view_(view)
+            , pos_(pos) {}
+
+            const basic_filtered_string_view* view_ = nullptr;
+            std::size_t pos_ = 0;
+        };
+
+    public:
+        using predicate_type = Pred;
+
+        /**
+            Constructors
+        */
+        basic_filtered_string_view() requires std::default_initializable<Pred>
+        : pointer_(nullptr)
+        , length_(0)
+        , predicate_() {}
+
+        basic_filtered_string_view(const std::string& str, Pred pred = Pred())
+        : pointer_(str.data())
+        , length_(str.size())
+        , predicate_(std::move(pred)) {}
+
+        basic_filtered_string_view(const char* str, Pred pred = Pred())
+        : pointer_(str)
+        , length_(std::strlen(str))
+        , predicate_(std::move(pred)) {}
+
+        /**
+            member operators
+        */
+        auto operator[](std::size_t n) const -> const char& {
+            auto count = std::size_t{0};
+            for (auto i = std::size_t{0}; i < length_; ++i) {
+                if (predicate_(pointer_[i])) {
+                    if (count == n) {
+                        return pointer_[i];
+                    }
+                    ++count;
+                }
+            }
+            return pointer_[0];
+        }
+
+        explicit operator std::string() const {
+            auto result = std::string{};
+            result.reserve(length_);
+            for (auto i = std::size_t{0}; i < length_; ++i) {
+                if (predicate_(pointer_[i])) {
+                    result.push_back(pointer_[i]);
+                }
+            }
+            return result;
+        }
+
+        operator filtered_string_view() const {
+            return filtered_string_view{pointer_, 0, length_, filter{predicate_}};
+        }
+
+        /**
+            member functions
+        */
+        auto at(std::size_t index) const -> const char& {
+            auto count = std::size_t{0};
+            for (auto i = std::size_t{0}; i < length_; ++i) {
+                if (predicate_(pointer_[i])) {
+                    if (count == index) {
+                        return pointer_[i];
+                    }
+                    ++count;
+                }
+            }
+            throw std::domain_error{"filtered_string_view::at(" + std::to_string(index) + "): invalid index"};
+        }
+
+        auto size() const -> std::size_t {
+            auto count = std::size_t{0};
+            for (auto i = std::size_t{0}; i < length_; ++i) {
+                if (predicate_(pointer_[i])) {
+                    ++count;
+                }
+            }
+            return count;
+        }
+
+        auto empty() const -> bool {
+            return first_valid(0) == length_;
+        }
+
+        auto data() const noexcept -> const char* {
+            return pointer_;
+        }
+
+        auto predicate() const noexcept -> const Pred& {
+            return predicate_;
+        }
+
+        using iterator = iter;
+        using const_iterator = iter;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        auto begin() const -> iterator {
+            return iterator(this, first_valid(0));
+        }
+        auto end() const -> iterator {
+            return iterator(this, length_);
+        }
+        auto cbegin() const -> const_iterator {
+            return begin();
+        }
+        auto cend() const -> const_iterator {
+            return end();
+        }
+        auto rbegin() const -> reverse_iterator {
+            return reverse_iterator(end());
+        }
+        auto rend() const -> reverse_iterator {
+            return reverse_iterator(begin());
+        }
+        auto crbegin() const -> const_reverse_iterator {
+            return rbegin();
+        }
+        auto crend() const -> const_reverse_iterator {
+            return rend();
+        }
+
+    private:
+        auto first_valid(std::size_t start) const -> std::size_t {
+            while (start < length_ && !predicate_(pointer_[start])) {
+                ++start;
+            }
+            return start;
+        }
+
+        const char* pointer_;
+        std::size_t length_;
+        [[no_unique_address]] Pred predicate_;
+    };
+
+    template<typename Pred>
+    basic_filtered_string_view(const char*, Pred) -> basic_filtered_string_view<Pred>;
+    template<typename Pred>
+    basic_filtered_string_view(const std::string&, Pred) -> basic_filtered_string_view<Pred>;
+
+    /**
+        non-member operators
+    */
+    template<typename P1, typename P2>
+    auto operator==(const basic_filtered_string_view<P1>& lhs, const basic_filtered_string_view<P2>& rhs) -> bool {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+
+    template<typename P1, typename P2>
+    auto operator<=>(const basic_filtered_string_view<P1>& lhs, const basic_filtered_string_view<P2>& rhs)
+        -> std::strong_ordering {
+        // as unsigned char, like std::char_traits<char> and filtered_string_view
+        return std::lexicographical_compare_three_way(lhs.begin(),
+                                                      lhs.end(),
+                                                      rhs.begin(),
+                                                      rhs.end(),
+                                                      [](unsigned char a, unsigned char b) { return a <=> b; });
+    }
+
+    template<typename Pred>
+    auto operator<<(std::ostream& os, const basic_filtered_string_view<Pred>& fsv) -> std::ostream& {
+        for (auto c : fsv) {
+            os << c;
+        }
+        return os;
+    }
+} // namespace fsv
+
+#endif // COMP6771_ASS2_BASIC_FSV_H
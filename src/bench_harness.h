@@ -0,0 +1,94 @@
+#ifndef COMP6771_ASS2_BENCH_HARNESS_H
+#define COMP6771_ASS2_BENCH_HARNESS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <utility>
+
+namespace fsv::bench {
+    // keeps the compiler from discarding a result the benchmark does not otherwise use
+    template<typename T>
+    inline auto keep(const T& value) -> void {
+        asm volatile("" : : "m"(value) : "memory");
+    }
+
+    struct measurement {
+        double ns_per_op;
+        // input bytes processed per second, or 0 when the operation does not scale with the input
+        double gb_per_s;
+        std::size_t iterations;
+    };
+
+    // the time iterations back-to-back calls of op take
+    template<typename F>
+    auto time_batch(std::size_t iterations, F&& op) -> std::chrono::nanoseconds {
+        using clock = std::chrono::steady_clock;
+        auto const start = clock::now();
+        for (auto i = std::size_t{0}; i < iterations; ++i) {
+            op();
+        }
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start);
+    }
+
+    /**
+        Times op, doubling the number of calls until a batch takes at least min_time, and reports the
+        per-call cost of that batch. bytes is the input each call processes.
+    */
+    template<typename F>
+    auto measure(std::size_t bytes, std::chrono::nanoseconds min_time, F&& op) -> measurement {
+        op();
+        for (auto iterations = std::size_t{1};; iterations *= 2) {
+            auto const elapsed = time_batch(iterations, op);
+            if (elapsed >= min_time || iterations >= (std::size_t{1} << 40)) {
+                auto const ns = static_cast<double>(elapsed.count()) / static_cast<double>(iterations);
+                return {ns, ns > 0 ? static_cast<double>(bytes) / ns : 0.0, iterations};
+            }
+        }
+    }
+
+    /**
+        size bytes in which a fraction selectivity are accepted characters, digits with a comma about
+        every sixteenth, and the rest are lowercase letters. Filters keep everything but the letters.
+    */
+    inline auto make_input(std::size_t size, double selectivity, std::uint64_t seed = 6771) -> std::string {
+        auto engine = std::mt19937_64{seed};
+        auto coin = std::uniform_real_distribution<double>{0.0, 1.0};
+        auto letter = std::uniform_int_distribution<int>{'a', 'z'};
+        auto digit = std::uniform_int_distribution<int>{'0', '9'};
+        auto result = std::string(size, '\0');
+        for (auto& c : result) {
+            if (coin(engine) >= selectivity) {
+                c = static_cast<char>(letter(engine));
+            }
+            else {
+                c = coin(engine) < 1.0 / 16 ? ',' : static_cast<char>(digit(engine));
+            }
+        }
+        return result;
+    }
+
+    /**
+        make_input and an equal copy of it in a buffer of its own. Comparing views over the two reads
+        both buffers, as comparing two different strings does; a view compared with itself would read
+        every cache line twice and find it already loaded the second time.
+    */
+    struct input_pair {
+        std::string text;
+        std::string twin;
+    };
+
+    inline auto make_input_pair(std::size_t size, double selectivity) -> input_pair {
+        auto text = make_input(size, selectivity);
+        auto twin = text;
+        return {std::move(text), std::move(twin)};
+    }
+
+    inline auto is_not_letter(const char& c) -> bool {
+        return c < 'a' || c > 'z';
+    }
+} // namespace fsv::bench
+
+#endif // COMP6771_ASS2_BENCH_HARNESS_H
@@ -0,0 +1,140 @@
+#ifndef COMP6771_ASS2_CHAR_CLASS_H
+#define COMP6771_ASS2_CHAR_CLASS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace fsv {
+    /**
+        Predicate that accepts a fixed set of byte values, stored as a 256-bit table.
+        Views whose filter holds a char_class run table-driven SIMD kernels instead of calling
+        the predicate once per character.
+
+        The table is laid out by nibble: byte 16 * (hi / 8) + lo holds bit (hi % 8) for the
+        character with high nibble hi and low nibble lo, which is the form PSHUFB lookups need.
+    */
+    class char_class {
+    public:
+        constexpr char_class() noexcept = default;
+
+        constexpr explicit char_class(std::string_view chars) noexcept {
+            for (auto c : chars) {
+                insert(c);
+            }
+        }
+
+        static constexpr auto range(char first, char last) noexcept -> char_class {
+            auto result = char_class{};
+            for (auto c = static_cast<unsigned char>(first); c <= static_cast<unsigned char>(last); ++c) {
+                result.insert(static_cast<char>(c));
+                if (c == 0xFF) {
+                    break;
+                }
+            }
+            return result;
+        }
+
+        static constexpr auto all() noexcept -> char_class {
+            return ~char_class{};
+        }
+        static constexpr auto whitespace() noexcept -> char_class {
+            return char_class{" \t\n\v\f\r"};
+        }
+        static constexpr auto digit() noexcept -> char_class {
+            return range('0', '9');
+        }
+        static constexpr auto alpha() noexcept -> char_class {
+            return range('a', 'z') | range('A', 'Z');
+        }
+        static constexpr auto alnum() noexcept -> char_class {
+            return alpha() | digit();
+        }
+        static constexpr auto control() noexcept -> char_class {
+            auto result = range('\0', '\x1F');
+            result.insert('\x7F');
+            return result;
+        }
+
+        constexpr auto insert(char c) noexcept -> void {
+            auto const [byte, bit] = locate(c);
+            rows_[byte] = static_cast<std::uint8_t>(rows_[byte] | bit);
+        }
+
+        constexpr auto contains(char c) const noexcept -> bool {
+            auto const [byte, bit] = locate(c);
+            return (rows_[byte] & bit) != 0;
+        }
+
+        constexpr auto operator()(const char& c) const noexcept -> bool {
+            return contains(c);
+        }
+
+        // nibble-transposed table, see the class comment
+        constexpr auto rows() const noexcept -> const std::array<std::uint8_t, 32>& {
+            return rows_;
+        }
+
+        friend constexpr auto operator~(const char_class& cls) noexcept -> char_class {
+            auto result = char_class{};
+            for (auto i = std::size_t{0}; i < result.rows_.size(); ++i) {
+                result.rows_[i] = static_cast<std::uint8_t>(~cls.rows_[i]);
+            }
+            return result;
+        }
+
+        friend constexpr auto operator&(const char_class& lhs, const char_class& rhs) noexcept -> char_class {
+            auto result = char_class{};
+            for (auto i = std::size_t{0}; i < result.rows_.size(); ++i) {
+                result.rows_[i] = static_cast<std::uint8_t>(lhs.rows_[i] & rhs.rows_[i]);
+            }
+            return result;
+        }
+
+        friend constexpr auto operator|(const char_class& lhs, const char_class& rhs) noexcept -> char_class {
+            auto result = char_class{};
+            for (auto i = std::size_t{0}; i < result.rows_.size(); ++i) {
+                result.rows_[i] = static_cast<std::uint8_t>(lhs.rows_[i] | rhs.rows_[i]);
+            }
+            return result;
+        }
+
+        friend constexpr auto operator==(const char_class& lhs, const char_class& rhs) noexcept -> bool = default;
+
+    private:
+        struct position {
+            std::size_t byte;
+            std::uint8_t bit;
+        };
+
+        static constexpr auto locate(char c) noexcept -> position {
+            auto const u = static_cast<unsigned char>(c);
+            auto const hi = static_cast<std::size_t>(u >> 4);
+            return {16 * (hi / 8) + (u & 0x0FU), static_cast<std::uint8_t>(1U << (hi % 8))};
+        }
+
+        alignas(16) std::array<std::uint8_t, 32> rows_ = {};
+    };
+
+    /**
+        Declares that pred depends on nothing but the value of its argument. The predicate is probed
+        once for each of the 256 byte values and replaced by the equivalent char_class, so views
+        built from it, and from compose/substr of them, use table lookups instead of calling it.
+        Negative chars are among the values probed, so <cctype> calls in pred must cast their
+        argument to unsigned char.
+    */
+    template<typename Pred>
+    constexpr auto pure(const Pred& pred) -> char_class {
+        auto result = char_class{};
+        for (auto u = 0; u < 256; ++u) {
+            auto const c = static_cast<char>(u);
+            if (pred(c)) {
+                result.insert(c);
+            }
+        }
+        return result;
+    }
+} // namespace fsv
+
+#endif // COMP6771_ASS2_CHAR_CLASS_H
@@ -0,0 +1,375 @@
+#include "./filtered_string_view.h"
+#include "./basic_filtered_string_view.h"
+#include <catch2/catch.hpp>
+#include <cstdlib>
+#include <new>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Replaces the global allocation functions, nothrow forms included, for this executable so that
+// every allocation in it pairs with a matching deallocation and each test can count the heap
+// allocations an operation makes. Operations documented as non-allocating are checked for exactly
+// zero; the rest are checked against the allocations they cannot avoid.
+
+namespace {
+    std::size_t allocations = 0;
+    std::size_t deallocations = 0;
+
+    auto allocate(std::size_t size, std::size_t alignment = 0) -> void* {
+        ++allocations;
+        auto const bytes = size == 0 ? 1 : size;
+        auto const p = alignment == 0 ? std::malloc(bytes)
+                                      : std::aligned_alloc(alignment, (bytes + alignment - 1) / alignment * alignment);
+        if (p == nullptr) {
+            throw std::bad_alloc{};
+        }
+        return p;
+    }
+
+    auto deallocate(void* p) noexcept -> void {
+        if (p != nullptr) {
+            ++deallocations;
+            std::free(p);
+        }
+    }
+
+    struct allocation_count {
+        std::size_t allocations;
+        std::size_t deallocations;
+    };
+
+    // counts the allocations and deallocations made while op runs
+    template<typename F>
+    auto count_allocations(F&& op) -> allocation_count {
+        auto const allocated = allocations;
+        auto const deallocated = deallocations;
+        op();
+        return {allocations - allocated, deallocations - deallocated};
+    }
+
+    // a stream buffer over a caller's array, so that writing to it allocates nothing of its own
+    class array_buffer : public std::streambuf {
+    public:
+        array_buffer(char* first, std::size_t size) {
+            setp(first, first + size);
+        }
+
+        auto written() const -> std::string_view {
+            return {pbase(), static_cast<std::size_t>(pptr() - pbase())};
+        }
+    };
+
+    auto const text = std::string{"the quick brown fox, jumps over the lazy dog, 0123456789"};
+    auto const not_space = [](const char& c) { return c != ' '; };
+} // namespace
+
+auto operator new(std::size_t size) -> void* {
+    return allocate(size);
+}
+auto operator new[](std::size_t size) -> void* {
+    return allocate(size);
+}
+auto operator new(std::size_t size, std::align_val_t alignment) -> void* {
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+auto operator new[](std::size_t size, std::align_val_t alignment) -> void* {
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+auto operator new(std::size_t size, const std::nothrow_t&) noexcept -> void* {
+    try {
+        return allocate(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+auto operator new[](std::size_t size, const std::nothrow_t&) noexcept -> void* {
+    try {
+        return allocate(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+auto operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept -> void* {
+    try {
+        return allocate(size, static_cast<std::size_t>(alignment));
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+auto operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept -> void* {
+    try {
+        return allocate(size, static_cast<std::size_t>(alignment));
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+auto operator delete(void* p) noexcept -> void {
+    deallocate(p);
+}
+auto operator delete[](void* p) noexcept -> void {
+    deallocate(p);
+}
+auto operator delete(void* p, std::size_t) noexcept -> void {
+    deallocate(p);
+}
+auto operator delete[](void* p, std::size_t) noexcept -> void {
+    deallocate(p);
+}
+auto operator delete(void* p, std::align_val_t) noexcept -> void {
+    deallocate(p);
+}
+auto operator delete[](void* p, std::align_val_t) noexcept -> void {
+    deallocate(p);
+}
+auto operator delete(void* p, std::size_t, std::align_val_t) noexcept -> void {
+    deallocate(p);
+}
+auto operator delete[](void* p, std::size_t, std::align_val_t) noexcept -> void {
+    deallocate(p);
+}
+auto operator delete(void* p, const std::nothrow_t&) noexcept -> void {
+    deallocate(p);
+}
+auto operator delete[](void* p, const std::nothrow_t&) noexcept -> void {
+    deallocate(p);
+}
+auto operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept -> void {
+    deallocate(p);
+}
+auto operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept -> void {
+    deallocate(p);
+}
+
+TEST_CASE("ALLOCATION FREE CONSTRUCTION") {
+    SECTION("views over whole strings share the identity predicate") {
+        auto const counted = count_allocations([] {
+            auto const a = fsv::filtered_string_view{};
+            auto const b = fsv::filtered_string_view{text};
+            auto const c = fsv::filtered_string_view{"literal"};
+            CHECK(a.size() + b.size() + c.size() == text.size() + 7);
+        });
+        CHECK(counted.allocations == 0);
+    }
+
+    SECTION("a filtered view allocates its predicate node and frees it with the last copy") {
+        // the first predicate ever registered also sets up the registry
+        fsv::filtered_string_view{text, not_space}.size();
+        auto const counted = count_allocations([] {
+            auto const s = fsv::filtered_string_view{text, not_space};
+            auto const copy = s;
+            CHECK(copy.size() == text.size() - 9);
+        });
+        CHECK(counted.allocations == 1);
+        CHECK(counted.deallocations == 1);
+    }
+}
+
+TEST_CASE("ALLOCATION FREE VIEWS") {
+    auto s = fsv::filtered_string_view{text, not_space};
+    auto const table = fsv::filtered_string_view{text, ~fsv::char_class::whitespace()};
+    auto const twin = text;
+    auto const other = fsv::filtered_string_view{twin, not_space};
+    auto const comma = fsv::filtered_string_view{","};
+
+    SECTION("copying, moving and assigning") {
+        auto const counted = count_allocations([&] {
+            auto copy = s;
+            auto moved = std::move(copy);
+            copy = moved;
+            moved = table;
+            copy = std::move(moved);
+            CHECK(copy == table);
+        });
+        CHECK(counted.allocations == 0);
+    }
+
+    SECTION("size, subscript and at") {
+        auto const counted = count_allocations([&] {
+            auto fresh = s;
+            CHECK(fresh.size() == text.size() - 9);
+            CHECK(fresh[3] == 'q');
+            CHECK(fresh.at(3) == 'q');
+            CHECK_FALSE(fresh.empty());
+        });
+        CHECK(counted.allocations == 0);
+    }
+
+    SECTION("substr") {
+        auto const counted = count_allocations([&] {
+            auto const middle = fsv::substr(s, 3, 5);
+            auto const suffix = fsv::substr(table, 10);
+            auto const nested = fsv::substr(fsv::substr(middle, 1), 1, 2);
+            CHECK(middle.size() == 5);
+            CHECK(suffix.size() == table.size() - 10);
+            CHECK(nested.size() == 2);
+        });
+        CHECK(counted.allocations == 0);
+    }
+
+    SECTION("iteration in both directions") {
+        auto const counted = count_allocations([&] {
+            auto forward = 0;
+            for (auto c : s) {
+                forward += c == 'o';
+            }
+            auto backward = 0;
+            for (auto it = s.rbegin(); it != s.rend(); ++it) {
+                backward += *it == 'o';
+            }
+            CHECK(forward == 4);
+            CHECK(backward == 4);
+        });
+        CHECK(counted.allocations == 0);
+    }
+
+    SECTION("comparison") {
+        auto const counted = count_allocations([&] {
+            CHECK(s == other);
+            CHECK(s == table);
+            CHECK((s <=> other) == std::strong_ordering::equal);
+            CHECK(fsv::substr(s, 1) < s);
+        });
+        CHECK(counted.allocations == 0);
+    }
+
+    SECTION("runs and copy_to") {
+        char out[64] = {};
+        auto const counted = count_allocations([&] {
+            auto total = std::size_t{0};
+            for (auto run : s.runs()) {
+                total += run.size();
+            }
+            s.for_each_run([&](std::string_view run) { total += run.size(); });
+            CHECK(total == 2 * s.size());
+            CHECK(s.copy_to(out, sizeof(out)) == s.size());
+            CHECK(table.copy_to(out, sizeof(out)) == table.size());
+        });
+        CHECK(counted.allocations == 0);
+    }
+
+    SECTION("operator<<") {
+        char out[128] = {};
+        auto buffer = array_buffer{out, sizeof(out)};
+        auto os = std::ostream{&buffer};
+        auto const counted = count_allocations([&] { os << s << table; });
+        CHECK(counted.allocations == 0);
+        CHECK(buffer.written() == static_cast<std::string>(s) + static_cast<std::string>(table));
+    }
+
+    SECTION("lazy split") {
+        auto const counted = count_allocations([&] {
+            auto pieces = 0;
+            for (auto&& piece : fsv::lazy_split(s, comma)) {
+                pieces += !piece.empty();
+            }
+            CHECK(pieces == 3);
+        });
+        CHECK(counted.allocations == 0);
+    }
+
+    SECTION("indexed access") {
+        s.build_index();
+        auto const counted = count_allocations([&] {
+            auto const range = s.indexed();
+            CHECK(range[3] == 'q');
+            CHECK(static_cast<std::size_t>(range.end() - range.begin()) == s.size());
+        });
+        CHECK(counted.allocations == 0);
+    }
+
+    SECTION("views with the predicate in their type") {
+        auto const basic = fsv::basic_filtered_string_view{text, not_space};
+        auto const counted = count_allocations([&] {
+            auto const copy = basic;
+            auto spaces = 0;
+            for (auto c : copy) {
+                spaces += c == ' ';
+            }
+            CHECK(spaces == 0);
+            CHECK(copy.size() == s.size());
+        });
+        CHECK(counted.allocations == 0);
+    }
+}
+
+TEST_CASE("BOUNDED ALLOCATIONS") {
+    auto const s = fsv::filtered_string_view{text, not_space};
+
+    SECTION("materialising allocates the string once") {
+        auto const counted = count_allocations([&] {
+            auto const str = static_cast<std::string>(s);
+            CHECK(str.size() == s.size());
+        });
+        CHECK(counted.allocations == 1);
+    }
+
+    SECTION("split allocates only for its vector") {
+        auto const pieces_of = [](std::size_t n) {
+            return count_allocations([n] {
+                       auto v = std::vector<fsv::filtered_string_view>{};
+                       for (auto i = std::size_t{0}; i < n; ++i) {
+                           v.emplace_back();
+                       }
+                   })
+                .allocations;
+        };
+        auto const comma = fsv::filtered_string_view{","};
+        auto const counted = count_allocations([&] { CHECK(fsv::split(s, comma).size() == 3); });
+        CHECK(counted.allocations == pieces_of(3));
+
+        auto const many = std::string(1000, ',');
+        auto const commas = fsv::filtered_string_view{many};
+        auto const counted_many = count_allocations([&] { CHECK(fsv::split(commas, comma).size() == 1001); });
+        CHECK(counted_many.allocations == pieces_of(1001));
+    }
+
+    SECTION("composing tables allocates one merged table and its node") {
+        auto const table = fsv::filtered_string_view{text, ~fsv::char_class::whitespace()};
+        auto const filters = std::vector<fsv::filter>{fsv::char_class::alpha(), ~fsv::char_class::digit()};
+        auto const counted = count_allocations([&] {
+            auto const composed = fsv::compose(table, filters);
+            CHECK(composed.size() == 35);
+        });
+        CHECK(counted.allocations == 2);
+        CHECK(counted.deallocations == counted.allocations);
+    }
+
+    SECTION("composing lambdas allocates a copy of the filters, the closure holding it and its node") {
+        auto const filters = std::vector<fsv::filter>{not_space, [](const char& c) { return c != ','; }};
+        auto const counted = count_allocations([&] {
+            auto const composed = fsv::compose(s, filters);
+            CHECK(composed.size() == text.size() - 11);
+        });
+        CHECK(counted.allocations == 3);
+        CHECK(counted.deallocations == counted.allocations);
+    }
+
+    SECTION("a table composed with a lambda is copied into the filters as well") {
+        auto const not_comma = [](const char& c) { return c != ','; };
+        auto const filters = std::vector<fsv::filter>{~fsv::char_class::whitespace(), not_comma};
+        auto const counted = count_allocations([&] {
+            auto const composed = fsv::compose(s, filters);
+            CHECK(composed.size() == text.size() - 11);
+        });
+        CHECK(counted.allocations == 4);
+        CHECK(counted.deallocations == counted.allocations);
+    }
+
+    SECTION("build_index allocates the bitmap, its block ranks, the index and a node of its own") {
+        // shares the node of s, which stays alive
+        auto indexed = s;
+        auto const counted = count_allocations([&] { indexed.build_index(); });
+        CHECK(counted.allocations == 4);
+        CHECK(counted.deallocations == 0);
+
+        auto const again = count_allocations([&] { indexed.build_index(); });
+        CHECK(again.allocations == 0);
+
+        auto const released = count_allocations([&] { indexed = s; });
+        CHECK(released.allocations == 0);
+        CHECK(released.deallocations == 4);
+    }
+}
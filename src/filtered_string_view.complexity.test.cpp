@@ -0,0 +1,108 @@
+#include "./filtered_string_view.h"
+#include <catch2/catch.hpp>
+#include <string>
+
+// Bounds the number of predicate calls each operation makes on an n-character input. Built only
+// with -DFSV_COUNT_PREDICATE_CALLS=ON, which makes the library count every call of a stored
+// predicate in fsv::predicate_calls. Table predicates run in vectorised kernels without calls, so
+// every view here uses a lambda.
+
+namespace {
+    constexpr auto n = std::size_t{1} << 14;
+
+    // counts the predicate calls made while op runs
+    template<typename F>
+    auto count_calls(F&& op) -> std::uint64_t {
+        auto const before = fsv::predicate_calls.load();
+        op();
+        return fsv::predicate_calls.load() - before;
+    }
+
+    // every fourth character is a letter, which the views filter out; the rest are digits with a
+    // comma every sixteenth character
+    auto make_text() -> std::string {
+        auto text = std::string(n, '0');
+        for (auto i = std::size_t{0}; i < n; ++i) {
+            text[i] = i % 4 == 3 ? 'x' : i % 16 == 8 ? ',' : static_cast<char>('0' + i % 10);
+        }
+        return text;
+    }
+
+    auto const not_letter = [](const char& c) { return c != 'x'; };
+} // namespace
+
+TEST_CASE("LINEAR PREDICATE CALLS") {
+    auto const text = make_text();
+    auto const twin = text;
+    auto const kept = n - n / 4;
+
+    SECTION("size calls the predicate once per character, and only the first time") {
+        auto const s = fsv::filtered_string_view{text, not_letter};
+        CHECK(count_calls([&] { CHECK(s.size() == kept); }) == n);
+        CHECK(count_calls([&] { CHECK(s.size() == kept); }) == 0);
+    }
+
+    SECTION("a full iteration in either direction is linear") {
+        auto s = fsv::filtered_string_view{text, not_letter};
+        auto const forward = count_calls([&] {
+            auto count = std::size_t{0};
+            for (auto it = s.begin(); it != s.end(); ++it) {
+                ++count;
+            }
+            CHECK(count == kept);
+        });
+        CHECK(forward <= n + 1);
+        auto const backward = count_calls([&] {
+            auto count = std::size_t{0};
+            for (auto it = s.rbegin(); it != s.rend(); ++it) {
+                ++count;
+            }
+            CHECK(count == kept);
+        });
+        CHECK(backward <= 2 * n);
+    }
+
+    SECTION("operator== and operator<=> on two n-character views are linear") {
+        auto const s = fsv::filtered_string_view{text, not_letter};
+        auto const other = fsv::filtered_string_view{twin, not_letter};
+        s.size();
+        other.size();
+        CHECK(count_calls([&] { CHECK(s == other); }) <= 2 * n);
+        CHECK(count_calls([&] { CHECK((s <=> other) == std::strong_ordering::equal); }) <= 2 * n);
+    }
+
+    SECTION("substr walks at most the characters before its end") {
+        auto const s = fsv::filtered_string_view{text, not_letter};
+        s.size();
+        CHECK(count_calls([&] { CHECK(fsv::substr(s, kept / 2, 10).size() == 10); }) <= n / 2 + 32);
+        CHECK(count_calls([&] { CHECK(fsv::substr(s, kept - 10).size() == 10); }) <= n);
+    }
+
+    SECTION("split is linear however many pieces it makes") {
+        auto const s = fsv::filtered_string_view{text, not_letter};
+        auto const comma = fsv::filtered_string_view{","};
+        auto const calls = count_calls([&] { CHECK(fsv::split(s, comma).size() == n / 16 + 1); });
+        CHECK(calls <= 2 * n);
+    }
+
+    SECTION("materialising is linear") {
+        auto const s = fsv::filtered_string_view{text, not_letter};
+        CHECK(count_calls([&] { CHECK(static_cast<std::string>(s).size() == kept); }) <= 2 * n);
+    }
+
+    SECTION("subscripting calls the predicate only up to the character") {
+        auto const s = fsv::filtered_string_view{text, not_letter};
+        CHECK(count_calls([&] { CHECK(s[2] == '2'); }) <= 3);
+        CHECK(count_calls([&] { CHECK(s[kept / 2] != 'x'); }) <= n / 2 + 2);
+    }
+
+    SECTION("an indexed view answers without calling the predicate") {
+        auto s = fsv::filtered_string_view{text, not_letter};
+        CHECK(count_calls([&] { s.build_index(); }) == n);
+        CHECK(count_calls([&] {
+                  CHECK(s.size() == kept);
+                  CHECK(fsv::substr(s, kept / 2, 10).size() == 10);
+              })
+              == 0);
+    }
+}
@@ -2,38 +2,54 @@
 #include <algorithm>
 #include <sstream>
 
+#include "./simd.h"
+
 namespace fsv {
-    filter fsv::filtered_string_view::default_predicate = [](const char&) { return true; };
+    filter fsv::filtered_string_view::default_predicate = detail::accept_all{};
     /**
         Constructors
     */
     filtered_string_view::filtered_string_view()
     : pointer_(nullptr)
+    , offset_(0)
     , length_(0)
-    , predicate_(default_predicate) {}
+    , predicate_() {}
 
     filtered_string_view::filtered_string_view(const std::string& str, filter pred)
     : pointer_(str.data())
-    , length_(str.size())
-    , predicate_(pred) {}
+    , offset_(0)
+    , length_(narrow(str.size()))
+    , predicate_(std::move(pred)) {}
 
     filtered_string_view::filtered_string_view(const char* str, filter pred)
     : pointer_(str)
-    , length_(std::strlen(str))
-    , predicate_(pred) {}
+    , offset_(0)
+    , length_(narrow(std::strlen(str)))
+    , predicate_(std::move(pred)) {}
+
+    filtered_string_view::filtered_string_view(const char* data, std::size_t offset, std::size_t length, filter pred)
+    : pointer_(data)
+    , offset_(narrow(offset))
+    , length_(narrow(length))
+    , predicate_(std::move(pred)) {}
 
     filtered_string_view::filtered_string_view(const filtered_string_view& other)
     : pointer_(other.pointer_)
+    , offset_(other.offset_)
     , length_(other.length_)
-    , predicate_(other.predicate_) {}
+    , predicate_(other.predicate_)
+    , size_(other.size_.load(std::memory_order_relaxed)) {}
 
     filtered_string_view::filtered_string_view(filtered_string_view&& other) noexcept
     : pointer_(other.pointer_)
+    , offset_(other.offset_)
     , length_(other.length_)
-    , predicate_(std::move(other.predicate_)) {
+    , predicate_(std::move(other.predicate_))
+    , size_(other.size_.load(std::memory_order_relaxed)) {
         other.pointer_ = nullptr;
+        other.offset_ = 0;
         other.length_ = 0;
-        other.predicate_ = filter{};
+        other.size_.store(0, std::memory_order_relaxed);
     }
 
     /**
@@ -42,8 +58,10 @@ namespace fsv {
     auto filtered_string_view::operator=(const filtered_string_view& other) -> filtered_string_view& {
         if (this != &other) {
             pointer_ = other.pointer_;
+            offset_ = other.offset_;
             length_ = other.length_;
             predicate_ = other.predicate_;
+            size_.store(other.size_.load(std::memory_order_relaxed), std::memory_order_relaxed);
         }
         return *this;
     }
@@ -51,49 +69,33 @@ namespace fsv {
     auto filtered_string_view::operator=(filtered_string_view&& other) -> filtered_string_view& {
         if (this != &other) {
             pointer_ = other.pointer_;
+            offset_ = other.offset_;
             length_ = other.length_;
             predicate_ = std::move(other.predicate_);
+            size_.store(other.size_.load(std::memory_order_relaxed), std::memory_order_relaxed);
 
             other.pointer_ = nullptr;
+            other.offset_ = 0;
             other.length_ = 0;
-            other.predicate_ = filter{};
+            other.size_.store(0, std::memory_order_relaxed);
         }
         return *this;
     }
 
     auto filtered_string_view::operator[](std::size_t n) const -> const char& {
-        auto count = std::size_t{0};
-        for (auto i = std::size_t{0}; i < length_; ++i) {
-            if (predicate_(pointer_[i])) {
-                if (count == n) {
-                    return pointer_[i];
-                }
-                ++count;
-            }
-        }
-        return pointer_[0];
+        auto const pos = raw_position(0, n);
+        return raw()[pos < length_ ? pos : 0];
     }
 
-    filtered_string_view::operator std::string() {
-        auto result = std::string{};
-        result.reserve(length_);
-        for (auto i = std::size_t{0}; i < length_; ++i) {
-            if (predicate_(pointer_[i])) {
-                result.push_back(pointer_[i]);
-            }
-        }
+    filtered_string_view::operator std::string() const {
+        auto result = std::string(size(), '\0');
+        copy_to(result.data(), result.size());
         return result;
     }
 
     auto filtered_string_view::at(std::size_t index) -> const char& {
-        auto count = std::size_t{0};
-        for (auto i = std::size_t{0}; i < length_; ++i) {
-            if (predicate_(pointer_[i])) {
-                if (count == index) {
-                    return pointer_[i];
-                }
-                ++count;
-            }
+        if (auto const pos = raw_position(0, index); pos < length_) {
+            return raw()[pos];
         }
         std::ostringstream oss;
         oss << "filtered_string_view::at(" << index << "): invalid index";
@@ -101,17 +103,22 @@ namespace fsv {
     }
 
     auto filtered_string_view::size() const -> std::size_t {
-        auto count = std::size_t{0};
-        for (auto i = std::size_t{0}; i < length_; ++i) {
-            if (predicate_(pointer_[i])) {
-                ++count;
-            }
+        auto const cached = size_.load(std::memory_order_relaxed);
+        if (cached != unknown_size) {
+            return cached;
         }
+        auto const& index = predicate_->index;
+        auto const count = index ? index->rank(offset_ + length_) - index->rank(offset_) : count_valid();
+        size_.store(static_cast<std::uint32_t>(count), std::memory_order_relaxed);
         return count;
     }
 
     auto filtered_string_view::empty() const -> bool {
-        return (size() == 0);
+        auto const count = size_.load(std::memory_order_relaxed);
+        if (count != unknown_size) {
+            return count == 0;
+        }
+        return first_valid(0) == length_;
     }
 
     auto filtered_string_view::data() const -> const char* {
@@ -119,71 +126,281 @@ namespace fsv {
     }
 
     auto filtered_string_view::predicate() const -> const filter& {
-        return predicate_;
+        return predicate_->function;
     }
 
     /**
-        non-member operators
+        rank/select index
     */
-    auto operator==(const filtered_string_view& lhs, const filtered_string_view& rhs) -> bool {
-        if (lhs.size() != rhs.size()) {
-            return false;
+    auto filtered_string_view::build_index() -> void {
+        if (!has_index()) {
+            // nodes are immutable and shared, so indexing gives this view a node of its own
+            auto index = std::make_unique<const detail::rank_select_index>(
+                detail::rank_select_index::build(pointer_, offset_ + length_, *predicate_));
+            size_.store(static_cast<std::uint32_t>(index->rank(offset_ + length_) - index->rank(offset_)),
+                        std::memory_order_relaxed);
+            predicate_ = detail::shared_predicate{predicate_->function, std::move(index)};
+        }
+    }
+
+    auto filtered_string_view::has_index() const noexcept -> bool {
+        return predicate_->index != nullptr;
+    }
+
+    auto filtered_string_view::indexed() const -> std::ranges::subrange<indexed_iterator> {
+        auto const index = predicate_->index.get();
+        if (index == nullptr) {
+            throw std::logic_error{"filtered_string_view::indexed(): build_index() has not been called"};
+        }
+        return {indexed_iterator(pointer_, index, index->rank(offset_)),
+                indexed_iterator(pointer_, index, index->rank(offset_ + length_))};
+    }
+
+    /**
+        Implementation-specific helper functions
+    */
+    auto filtered_string_view::narrow(std::size_t length) -> std::uint32_t {
+        if (length >= unknown_size) {
+            throw std::length_error{"filtered_string_view: " + std::to_string(length)
+                                    + " characters exceed the 32-bit length limit"};
+        }
+        return static_cast<std::uint32_t>(length);
+    }
+
+    auto filtered_string_view::count_valid() const -> std::size_t {
+        if (predicate_->identity) {
+            return length_;
+        }
+        if (predicate_->table != nullptr) {
+            return detail::simd::count(*predicate_->table, raw(), length_);
         }
-        for (auto i = std::size_t{0}; i < lhs.size(); ++i) {
-            if (lhs[i] != rhs[i]) {
-                return false;
+        auto count = std::size_t{0};
+        for (auto i = std::size_t{0}; i < length_; ++i) {
+            if ((*predicate_)(raw()[i])) {
+                ++count;
             }
         }
-        return true;
+        return count;
+    }
+
+    auto filtered_string_view::first_in_table(const char_class& table,
+                                              const char* first,
+                                              std::size_t length,
+                                              std::size_t start) noexcept -> std::size_t {
+        // dense classes usually accept the very next character, so try that before a block scan
+        if (start >= length || table.contains(first[start])) {
+            return start;
+        }
+        return start + detail::simd::find_first(table, first + start, length - start);
+    }
+
+    auto filtered_string_view::last_valid(const detail::predicate_node& pred,
+                                          const char* first,
+                                          std::size_t before) noexcept -> std::size_t {
+        if (before == 0) {
+            return 0;
+        }
+        auto pos = before - 1;
+        if (pred.identity) {
+            return pos;
+        }
+        if (auto const table = pred.table) {
+            if (table->contains(first[pos])) {
+                return pos;
+            }
+            auto const found = detail::simd::find_last(*table, first, pos);
+            return found == pos ? 0 : found;
+        }
+        while (pos > 0 && !pred(first[pos])) {
+            --pos;
+        }
+        return pos;
     }
 
-    auto operator<(const filtered_string_view& lhs, const filtered_string_view& rhs) -> bool {
-        return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    auto filtered_string_view::first_invalid(std::size_t start) const noexcept -> std::size_t {
+        if (predicate_->identity) {
+            return length_;
+        }
+        if (predicate_->table == nullptr) {
+            while (start < length_ && (*predicate_)(raw()[start])) {
+                ++start;
+            }
+            return start;
+        }
+        // short runs are common, so probe a few characters before starting a block scan
+        for (auto const probe_end = std::min(start + 16, std::size_t{length_}); start < probe_end; ++start) {
+            if (!predicate_->table->contains(raw()[start])) {
+                return start;
+            }
+        }
+        return start + detail::simd::find_first(~*predicate_->table, raw() + start, length_ - start);
     }
 
-    auto operator>(const filtered_string_view& lhs, const filtered_string_view& rhs) -> bool {
-        return rhs < lhs;
+    auto filtered_string_view::copy_to(char* out, std::size_t capacity) const -> std::size_t {
+        if (predicate_->identity) {
+            // default-constructed and moved-from views have no buffer, which memcpy must not be given
+            return static_cast<std::size_t>(std::copy_n(raw(), std::min(std::size_t{length_}, capacity), out) - out);
+        }
+        if (predicate_->table != nullptr) {
+            return detail::simd::compact(*predicate_->table, raw(), length_, out, capacity);
+        }
+        auto written = std::size_t{0};
+        for (auto [first, last] = next_run(0); first < length_ && written < capacity;
+             std::tie(first, last) = run_after(last)) {
+            auto const n = std::min(last - first, capacity - written);
+            std::memcpy(out + written, raw() + first, n);
+            written += n;
+        }
+        return written;
     }
 
-    auto operator<=(const filtered_string_view& lhs, const filtered_string_view& rhs) -> bool {
-        return !(rhs < lhs);
+    auto filtered_string_view::next_run(std::size_t from) const noexcept -> std::pair<std::size_t, std::size_t> {
+        auto const first = first_valid(from);
+        return {first, first < length_ ? first_invalid(first + 1) : length_};
     }
 
-    auto operator>=(const filtered_string_view& lhs, const filtered_string_view& rhs) -> bool {
-        return !(lhs < rhs);
+    auto filtered_string_view::run_after(std::size_t last) const noexcept -> std::pair<std::size_t, std::size_t> {
+        // the character at last is already known to be rejected
+        return next_run(last < length_ ? last + 1 : length_);
     }
 
-    auto operator<<(std::ostream& os, const filtered_string_view& fsv) -> std::ostream& {
-        for (auto it = fsv.begin(); it != fsv.end(); ++it) {
-            os << *it;
+    auto filtered_string_view::visit_runs(detail::simd::run_sink sink, void* context) const -> void {
+        if (predicate_->identity) {
+            if (length_ > 0) {
+                sink(context, raw(), length_);
+            }
+            return;
+        }
+        if (predicate_->table != nullptr) {
+            detail::simd::runs(*predicate_->table, raw(), length_, sink, context);
+            return;
+        }
+        for (auto [first, last] = next_run(0); first < length_; std::tie(first, last) = run_after(last)) {
+            sink(context, raw() + first, last - first);
         }
-        return os;
+    }
+
+    auto filtered_string_view::raw_position(std::size_t from, std::size_t n) const -> std::size_t {
+        if (predicate_->identity) {
+            return from + std::min(n, length_ - from);
+        }
+        if (auto const& index = predicate_->index) {
+            auto const target = index->rank(offset_ + from) + n;
+            return target < index->rank(offset_ + length_) ? index->select(target) - offset_ : length_;
+        }
+        auto pos = first_valid(from);
+        for (; n > 0 && pos < length_; --n) {
+            pos = first_valid(pos + 1);
+        }
+        return pos;
+    }
+
+    auto filtered_string_view::slice(std::size_t first, std::size_t last, std::size_t size) const
+        -> filtered_string_view {
+        // slicing only narrows the raw bounds; the predicate is shared unchanged
+        auto result = filtered_string_view{*this};
+        result.offset_ = static_cast<std::uint32_t>(offset_ + first);
+        result.length_ = static_cast<std::uint32_t>(last - first);
+        result.size_.store(static_cast<std::uint32_t>(size), std::memory_order_relaxed);
+        return result;
+    }
+
+    auto filtered_string_view::match_end(std::size_t pos, const filtered_string_view& tok) const -> std::size_t {
+        // if tok's filtered text occurs at accepted position pos, the next accepted position after
+        // the occurrence; otherwise 0
+        for (auto it = tok.begin(); it != tok.end(); ++it) {
+            if (pos >= length_ || raw()[pos] != *it) {
+                return 0;
+            }
+            pos = first_valid(pos + 1);
+        }
+        return pos;
+    }
+
+    auto filtered_string_view::find_piece(std::size_t first, const filtered_string_view& tok) const -> piece {
+        if (predicate_->identity && tok.predicate_->identity && tok.length_ > 0) {
+            auto const needle = std::string_view{tok.raw(), tok.length_};
+            auto const last = std::string_view{raw(), length_}.find(needle, first);
+            if (last == std::string_view::npos) {
+                return {length_, length_ - first, no_piece};
+            }
+            return {last, last - first, last + needle.size()};
+        }
+        auto size = std::size_t{0};
+        if (tok.empty()) {
+            for (auto pos = first_valid(first); pos < length_; pos = first_valid(pos + 1)) {
+                ++size;
+            }
+            return {length_, size, no_piece};
+        }
+        auto const lead = *tok.begin();
+        for (auto pos = first_valid(first); pos < length_; pos = first_valid(pos + 1)) {
+            if (raw()[pos] == lead) {
+                if (auto const next = match_end(pos, tok); next != 0) {
+                    return {pos, size, next};
+                }
+            }
+            ++size;
+        }
+        return {length_, size, no_piece};
     }
 
     /**
-        iterator class
+        non-member operators
     */
-    auto fsv::filtered_string_view::iter::operator++() -> iter& {
-        do {
-            ++pos_;
-        } while (pos_ < view_->length_ && !view_->predicate_(view_->pointer_[pos_]));
-        return *this;
+    auto operator==(const filtered_string_view& lhs, const filtered_string_view& rhs) -> bool {
+        if (lhs.predicate_->identity && rhs.predicate_->identity) {
+            return std::string_view{lhs.raw(), lhs.length_} == std::string_view{rhs.raw(), rhs.length_};
+        }
+        return lhs.size() == rhs.size() && std::is_eq(lhs <=> rhs);
+    }
+
+    auto operator<=>(const filtered_string_view& lhs, const filtered_string_view& rhs) -> std::strong_ordering {
+        if (lhs.predicate_->identity && rhs.predicate_->identity) {
+            return std::string_view{lhs.raw(), lhs.length_}.compare(std::string_view{rhs.raw(), rhs.length_}) <=> 0;
+        }
+        // compare the overlap of the current run on each side, then drop it and refill whichever ran out
+        auto const left = lhs.runs();
+        auto const right = rhs.runs();
+        auto l = left.begin();
+        auto r = right.begin();
+        auto a = std::string_view{};
+        auto b = std::string_view{};
+        while (true) {
+            if (a.empty() && l != left.end()) {
+                a = *l++;
+            }
+            if (b.empty() && r != right.end()) {
+                b = *r++;
+            }
+            if (a.empty() || b.empty()) {
+                return !a.empty() <=> !b.empty();
+            }
+            auto const n = std::min(a.size(), b.size());
+            if (auto const cmp = std::memcmp(a.data(), b.data(), n); cmp != 0) {
+                return cmp <=> 0;
+            }
+            a.remove_prefix(n);
+            b.remove_prefix(n);
+        }
+    }
+
+    auto operator<<(std::ostream& os, const filtered_string_view& fsv) -> std::ostream& {
+        fsv.for_each_run(
+            [&os](std::string_view run) { os.write(run.data(), static_cast<std::streamsize>(run.size())); });
+        return os;
     }
 
-    auto fsv::filtered_string_view::iter::operator++(int) -> iter {
+    /**
+        iterator class
+    */
+    auto fsv::filtered_string_view::iter::operator++(int) noexcept -> iter {
         iter copy = *this;
         ++(*this);
         return copy;
     }
 
-    auto fsv::filtered_string_view::iter::operator--() -> iter& {
-        do {
-            --pos_;
-        } while (pos_ > 0 && !view_->predicate_(view_->pointer_[pos_]));
-        return *this;
-    }
-
-    auto fsv::filtered_string_view::iter::operator--(int) -> iter {
+    auto fsv::filtered_string_view::iter::operator--(int) noexcept -> iter {
         iter copy = *this;
         --(*this);
         return copy;
@@ -193,74 +410,92 @@ namespace fsv {
         non-member utility functions
     */
     auto compose(const filtered_string_view& fsv, const std::vector<filter>& filts) -> filtered_string_view {
-        return filtered_string_view{fsv.data(), [filts](const char& c) {
-                                        for (const auto& filt : filts) {
-                                            if (!filt(c))
-                                                return false;
-                                        }
-                                        return true;
-                                    }};
+        // a conjunction of tables is itself a table, which keeps the composed view on the fast paths
+        auto const all_tables = std::all_of(filts.begin(), filts.end(), [](const filter& filt) {
+            return filt.target<char_class>() != nullptr;
+        });
+        if (all_tables) {
+            auto cls = char_class::all();
+            for (const auto& filt : filts) {
+                cls = cls & *filt.target<char_class>();
+            }
+            return filtered_string_view{fsv.pointer_, fsv.offset_, fsv.length_, cls};
+        }
+        // an init-capture, so the copy is not const and moves into the filter instead of being copied again
+        auto all_of = [filts = filts](const char& c) {
+            for (const auto& filt : filts) {
+                if (!filt(c))
+                    return false;
+            }
+            return true;
+        };
+        return filtered_string_view{fsv.pointer_, fsv.offset_, fsv.length_, std::move(all_of)};
     }
 
     auto substr(const filtered_string_view& fsv, size_t pos, std::optional<size_t> count) -> filtered_string_view {
-        auto indices = std::vector<std::size_t>{};
-        auto const data = fsv.data();
-        for (auto i = size_t{0}; i < fsv.size(); ++i) {
-            if (fsv.predicate()(data[i])) {
-                indices.push_back(i);
-            }
-        }
-        auto const filtered_size = indices.size();
+        auto const filtered_size = fsv.size();
         if (pos > filtered_size) {
             throw std::out_of_range{"filtered_string_view::substr(" + std::to_string(pos)
                                     + "): position out of range for filtered string of size "
                                     + std::to_string(filtered_size)};
         }
-        auto end = count.has_value() ? std::min(pos + count.value(), filtered_size) : filtered_size;
-        if (pos == end) {
-            return filtered_string_view{fsv.data(), [](const char&) { return false; }};
-        }
-        auto i_start = indices[pos];
-        auto i_end = indices[end - 1] + 1;
-
-        auto new_pred = [=, pred = fsv.predicate()](const char& c) -> bool {
-            auto offset = &c - data;
-            return offset >= static_cast<std::ptrdiff_t>(i_start) && offset < static_cast<std::ptrdiff_t>(i_end)
-                   && pred(c);
-        };
-
-        return filtered_string_view{fsv.data(), new_pred};
+        auto const n = std::min(count.value_or(filtered_size), filtered_size - pos);
+
+        auto const first = fsv.raw_position(0, pos);
+        // a suffix can keep the parent's raw end, which saves walking over its n characters
+        auto const last = n == 0                    ? first
+                          : pos + n == filtered_size ? std::size_t{fsv.length_}
+                                                     : fsv.raw_position(first, n);
+        return fsv.slice(first, last, n);
     }
 
     auto split(const filtered_string_view& fsv, const filtered_string_view& tok) -> std::vector<filtered_string_view> {
-        auto fsv_filtered = std::string{};
-        for (auto c : fsv)
-            fsv_filtered.push_back(c);
+        auto result = std::vector<filtered_string_view>{};
+        for (auto&& piece : lazy_split(fsv, tok)) {
+            result.push_back(std::move(piece));
+        }
+        return result;
+    }
+
+    auto lazy_split(const filtered_string_view& fsv, const filtered_string_view& tok) -> split_view {
+        return split_view{fsv, tok};
+    }
 
-        auto tok_filtered = std::string{};
-        for (auto c : tok)
-            tok_filtered.push_back(c);
+    /**
+        split_view
+    */
+    split_view::split_view(filtered_string_view fsv, filtered_string_view tok)
+    : fsv_(std::move(fsv))
+    , tok_(std::move(tok)) {}
 
-        if (tok_filtered.empty() || fsv_filtered.empty()) {
-            return {fsv};
+    auto split_view::begin() -> iter {
+        if (!first_piece_) {
+            first_piece_ = fsv_.find_piece(0, tok_);
         }
-        auto result = std::vector<filtered_string_view>{};
-        auto start = std::size_t{0};
-
-        while (start <= fsv_filtered.size()) {
-            auto pos = fsv_filtered.find(tok_filtered, start);
-            if (pos == std::string::npos) {
-                auto part = substr(fsv, start);
-                result.push_back(part);
-                break;
-            }
-            auto part = substr(fsv, start, pos - start);
-            result.push_back(part);
+        return iter{this, *first_piece_};
+    }
 
-            start = pos + tok_filtered.size();
+    split_view::iter::iter(const split_view* parent, filtered_string_view::piece first) noexcept
+    : parent_(parent)
+    , first_(0)
+    , piece_(first)
+    , done_(false) {}
+
+    auto split_view::iter::operator++() -> iter& {
+        if (piece_.next == filtered_string_view::no_piece) {
+            done_ = true;
+        }
+        else {
+            first_ = piece_.next;
+            piece_ = parent_->fsv_.find_piece(first_, parent_->tok_);
         }
+        return *this;
+    }
 
-        return result;
+    auto split_view::iter::operator++(int) -> iter {
+        auto copy = *this;
+        ++*this;
+        return copy;
     }
 
 } // namespace fsv
\ No newline at end of file
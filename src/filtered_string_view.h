@@ -1,40 +1,67 @@
 #ifndef COMP6771_ASS2_FSV_H
 #define COMP6771_ASS2_FSV_H
 
+#include <atomic>
 #include <compare>
 #include <cstring>
 #include <functional>
 #include <iterator>
+#include <limits>
+#include <memory>
 #include <optional>
+#include <ranges>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "./char_class.h"
+#include "./predicate_node.h"
+#include "./rank_select_index.h"
+#include "./simd.h"
 
 namespace fsv {
-    using filter = std::function<bool(const char&)>;
+    template<typename Pred>
+    class basic_filtered_string_view;
+    class split_view;
 
-    class filtered_string_view {
+    /**
+        Models std::ranges::view, bidirectional_range, common_range and sized_range. It is not a
+        borrowed_range: iterators point at the predicate the view shares, so they must not outlive
+        every view holding it.
+    */
+    class filtered_string_view : public std::ranges::view_interface<filtered_string_view> {
         class iter {
         public:
             using iterator_category = std::bidirectional_iterator_tag;
             using value_type = char;
             using difference_type = std::ptrdiff_t;
             using reference = const char&;
-            using pointer = void;
+            using pointer = const char*;
 
             iter() = default;
 
             auto operator*() const noexcept -> reference {
-                return view_->pointer_[pos_];
+                return first_[pos_];
             }
 
-            auto operator->() const noexcept -> pointer;
+            auto operator->() const noexcept -> pointer {
+                return first_ + pos_;
+            }
 
-            auto operator++() -> iter&;
-            auto operator++(int) -> iter;
-            auto operator--() -> iter&;
-            auto operator--(int) -> iter;
+            auto operator++() noexcept -> iter& {
+                pos_ = first_valid(*predicate_, first_, length_, pos_ + 1);
+                return *this;
+            }
+            auto operator++(int) noexcept -> iter;
+            auto operator--() noexcept -> iter& {
+                pos_ = last_valid(*predicate_, first_, pos_);
+                return *this;
+            }
+            auto operator--(int) noexcept -> iter;
 
             friend auto operator==(const iter& a, const iter& b) noexcept -> bool {
-                return a.view_ == b.view_ && a.pos_ == b.pos_;
+                return a.first_ == b.first_ && a.pos_ == b.pos_;
             }
 
             friend auto operator!=(const iter& a, const iter& b) noexcept -> bool {
@@ -44,14 +71,149 @@ namespace fsv {
         private:
             friend class filtered_string_view;
             iter(const filtered_string_view* view, std::size_t pos) noexcept
-            : view_(view)
+            : first_(view->raw())
+            , length_(view->length_)
+            , predicate_(&*view->predicate_)
             , pos_(pos) {}
             /* Implementation-specific private members */
-            const filtered_string_view* view_ = nullptr;
+            // a copy of the view's raw bounds and its predicate node, so stepping never goes
+            // through the view and survives the view being moved
+            const char* first_ = nullptr;
+            std::size_t length_ = 0;
+            const detail::predicate_node* predicate_ = nullptr;
             std::size_t pos_ = 0;
             /* Implementation-specific helper functions*/
         };
 
+        // walks the maximal runs of consecutive accepted characters as slices of the base buffer
+        class run_iter {
+        public:
+            using iterator_concept = std::forward_iterator_tag;
+            using iterator_category = std::input_iterator_tag;
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+
+            // user-provided so the iterator is default-constructible inside the enclosing class
+            run_iter() noexcept
+            : view_(nullptr)
+            , first_(0)
+            , last_(0) {}
+
+            auto operator*() const noexcept -> std::string_view {
+                return {view_->raw() + first_, last_ - first_};
+            }
+
+            auto operator++() -> run_iter& {
+                std::tie(first_, last_) = view_->run_after(last_);
+                return *this;
+            }
+
+            auto operator++(int) -> run_iter {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            friend auto operator==(const run_iter& a, const run_iter& b) noexcept -> bool {
+                return a.view_ == b.view_ && a.first_ == b.first_;
+            }
+
+        private:
+            friend class filtered_string_view;
+            run_iter(const filtered_string_view* view, std::pair<std::size_t, std::size_t> run) noexcept
+            : view_(view)
+            , first_(run.first)
+            , last_(run.second) {}
+
+            const filtered_string_view* view_;
+            std::size_t first_;
+            std::size_t last_;
+        };
+
+        // random-access walk over an indexed view by rank: the nth accepted character of the base
+        // buffer is base_[index_->select(n)], so moving by any distance is rank arithmetic
+        class rank_iter {
+        public:
+            using iterator_concept = std::random_access_iterator_tag;
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = char;
+            using difference_type = std::ptrdiff_t;
+            using reference = const char&;
+            using pointer = const char*;
+
+            rank_iter() noexcept
+            : base_(nullptr)
+            , index_(nullptr)
+            , rank_(0) {}
+
+            auto operator*() const noexcept -> reference {
+                return base_[index_->select(rank_)];
+            }
+            auto operator->() const noexcept -> pointer {
+                return base_ + index_->select(rank_);
+            }
+            auto operator[](difference_type n) const noexcept -> reference {
+                return *(*this + n);
+            }
+
+            auto operator++() noexcept -> rank_iter& {
+                ++rank_;
+                return *this;
+            }
+            auto operator++(int) noexcept -> rank_iter {
+                auto copy = *this;
+                ++rank_;
+                return copy;
+            }
+            auto operator--() noexcept -> rank_iter& {
+                --rank_;
+                return *this;
+            }
+            auto operator--(int) noexcept -> rank_iter {
+                auto copy = *this;
+                --rank_;
+                return copy;
+            }
+
+            auto operator+=(difference_type n) noexcept -> rank_iter& {
+                rank_ = static_cast<std::size_t>(static_cast<difference_type>(rank_) + n);
+                return *this;
+            }
+            auto operator-=(difference_type n) noexcept -> rank_iter& {
+                return *this += -n;
+            }
+            friend auto operator+(rank_iter it, difference_type n) noexcept -> rank_iter {
+                return it += n;
+            }
+            friend auto operator+(difference_type n, rank_iter it) noexcept -> rank_iter {
+                return it += n;
+            }
+            friend auto operator-(rank_iter it, difference_type n) noexcept -> rank_iter {
+                return it -= n;
+            }
+            friend auto operator-(const rank_iter& a, const rank_iter& b) noexcept -> difference_type {
+                return static_cast<difference_type>(a.rank_) - static_cast<difference_type>(b.rank_);
+            }
+
+            friend auto operator==(const rank_iter& a, const rank_iter& b) noexcept -> bool {
+                return a.rank_ == b.rank_;
+            }
+            friend auto operator<=>(const rank_iter& a, const rank_iter& b) noexcept -> std::strong_ordering {
+                return a.rank_ <=> b.rank_;
+            }
+
+        private:
+            friend class filtered_string_view;
+            rank_iter(const char* base, const detail::rank_select_index* index, std::size_t rank) noexcept
+            : base_(base)
+            , index_(index)
+            , rank_(rank) {}
+
+            const char* base_;
+            const detail::rank_select_index* index_;
+            std::size_t rank_;
+        };
+
     public:
         static filter default_predicate;
 
@@ -73,7 +235,7 @@ namespace fsv {
         auto operator=(const filtered_string_view& other) -> filtered_string_view&;
         auto operator=(filtered_string_view&& other) -> filtered_string_view&;
         auto operator[](size_t n) const -> const char&;
-        explicit operator std::string();
+        explicit operator std::string() const;
 
         /**
             member functions
@@ -83,6 +245,37 @@ namespace fsv {
         auto empty() const -> bool;
         auto data() const -> const char*;
         auto predicate() const -> const filter&;
+        // writes up to capacity filtered characters to out and returns how many were written
+        auto copy_to(char* out, std::size_t capacity) const -> std::size_t;
+
+        /**
+            rank/select index
+        */
+        auto build_index() -> void;
+        auto has_index() const noexcept -> bool;
+
+        // the filtered characters as a random-access range; throws std::logic_error without an index.
+        // Its iterators stay valid for as long as any view sharing the index is alive.
+        using indexed_iterator = rank_iter;
+        auto indexed() const -> std::ranges::subrange<indexed_iterator>;
+
+        /**
+            runs of accepted characters
+        */
+        using run_iterator = run_iter;
+
+        auto runs() const -> std::ranges::subrange<run_iterator> {
+            return {run_iterator(this, next_run(0)), run_iterator(this, {length_, length_})};
+        }
+
+        template<typename F>
+        auto for_each_run(F&& f) const -> void {
+            using callable = std::remove_reference_t<F>;
+            auto const sink = [](void* context, const char* run, std::size_t n) {
+                (*static_cast<callable*>(context))({run, n});
+            };
+            visit_runs(sink, const_cast<void*>(static_cast<const void*>(&f)));
+        }
 
         using iterator = iter;
         using const_iterator = iter;
@@ -115,30 +308,98 @@ namespace fsv {
         }
 
     private:
+        template<typename Pred>
+        friend class basic_filtered_string_view;
+        friend class split_view;
+        friend auto operator==(const filtered_string_view& lhs, const filtered_string_view& rhs) -> bool;
+        friend auto operator<=>(const filtered_string_view& lhs, const filtered_string_view& rhs)
+            -> std::strong_ordering;
+        friend auto compose(const filtered_string_view& fsv, const std::vector<filter>& filts) -> filtered_string_view;
+        friend auto substr(const filtered_string_view& fsv, size_t pos, std::optional<size_t> count)
+            -> filtered_string_view;
+
+        static constexpr auto unknown_size = std::numeric_limits<std::uint32_t>::max();
+
+        filtered_string_view(const char* data, std::size_t offset, std::size_t length, filter pred);
+
+        // offsets and lengths are stored in 32 bits; longer strings are rejected with length_error
+        static auto narrow(std::size_t length) -> std::uint32_t;
+
         /* Implementation-specific helper functions*/
-        auto first_valid(std::size_t start) const noexcept -> std::size_t {
-            while (start < length_ && !predicate_(pointer_[start])) {
+        auto count_valid() const -> std::size_t;
+        static auto first_in_table(const char_class& table,
+                                   const char* first,
+                                   std::size_t length,
+                                   std::size_t start) noexcept -> std::size_t;
+        // the last accepted position before the raw position before, or 0 when there is none
+        static auto last_valid(const detail::predicate_node& pred, const char* first, std::size_t before) noexcept
+            -> std::size_t;
+        auto first_invalid(std::size_t start) const noexcept -> std::size_t;
+        auto next_run(std::size_t from) const noexcept -> std::pair<std::size_t, std::size_t>;
+        auto run_after(std::size_t last) const noexcept -> std::pair<std::size_t, std::size_t>;
+        auto visit_runs(detail::simd::run_sink sink, void* context) const -> void;
+        auto raw_position(std::size_t from, std::size_t n) const -> std::size_t;
+        auto slice(std::size_t first, std::size_t last, std::size_t size) const -> filtered_string_view;
+        auto match_end(std::size_t pos, const filtered_string_view& tok) const -> std::size_t;
+
+        // one field of a split: raw bounds [first, last), its filtered size, and the raw offset of the
+        // field after the delimiter, or no_piece when this is the final field
+        static constexpr auto no_piece = std::numeric_limits<std::size_t>::max();
+        struct piece {
+            std::size_t last;
+            std::size_t size;
+            std::size_t next;
+        };
+        auto find_piece(std::size_t first, const filtered_string_view& tok) const -> piece;
+
+        // the view filters the raw range [raw(), raw() + length_) of the buffer starting at pointer_
+        auto raw() const noexcept -> const char* {
+            return pointer_ + offset_;
+        }
+
+        static auto first_valid(const detail::predicate_node& pred,
+                                const char* first,
+                                std::size_t length,
+                                std::size_t start) noexcept -> std::size_t {
+            if (pred.identity) {
+                return std::min(start, length);
+            }
+            if (pred.table != nullptr) {
+                return first_in_table(*pred.table, first, length, start);
+            }
+            while (start < length && !pred(first[start])) {
                 ++start;
             }
             return start;
         }
 
+        auto first_valid(std::size_t start) const noexcept -> std::size_t {
+            return first_valid(*predicate_, raw(), length_, start);
+        }
+
         /* Implementation-specific private members */
+        // 24 bytes on 64-bit targets. data() has to return the start of the original buffer, so
+        // a slice keeps that pointer and a 32-bit offset rather than a pointer to its own start.
         const char* pointer_;
-        std::size_t length_;
-        filter predicate_;
+        std::uint32_t offset_;
+        std::uint32_t length_;
+        // registry id of the predicate node, shared with every copy and slice of this view
+        detail::shared_predicate predicate_;
+        // filtered length, memoised on first demand
+        mutable std::atomic<std::uint32_t> size_ = unknown_size;
     };
 
+    static_assert(sizeof(filtered_string_view) <= sizeof(const char*) + 4 * sizeof(std::uint32_t));
+
     /**
         non-member operators
     */
     auto operator==(const filtered_string_view& lhs, const filtered_string_view& rhs) -> bool;
+    // orders by the filtered characters compared as unsigned char, like std::string
+    auto operator<=>(const filtered_string_view& lhs, const filtered_string_view& rhs) -> std::strong_ordering;
 
-    auto operator>(const filtered_string_view& lhs, const filtered_string_view& rhs) -> bool;
-    auto operator<(const filtered_string_view& lhs, const filtered_string_view& rhs) -> bool;
-    auto operator>=(const filtered_string_view& lhs, const filtered_string_view& rhs) -> bool;
-    auto operator<=(const filtered_string_view& lhs, const filtered_string_view& rhs) -> bool;
-
+    // writes each run of kept characters with one write; there is no std::formatter, so std::format
+    // callers pass static_cast<std::string>(fsv)
     auto operator<<(std::ostream& os, const filtered_string_view& fsv) -> std::ostream&;
 
     /**
@@ -149,6 +410,63 @@ namespace fsv {
         -> filtered_string_view;
     auto split(const filtered_string_view& fsv, const filtered_string_view& tok) -> std::vector<filtered_string_view>;
 
+    /**
+        Lazy form of split: a forward range that finds each field only when the iterator reaches it,
+        without building a vector or scanning past the last field the caller asks for. Like
+        std::ranges::split_view, begin() finds the first field once and caches it, so it is not const.
+    */
+    class split_view : public std::ranges::view_interface<split_view> {
+        class iter {
+        public:
+            using iterator_concept = std::forward_iterator_tag;
+            using iterator_category = std::input_iterator_tag;
+            using value_type = filtered_string_view;
+            using difference_type = std::ptrdiff_t;
+
+            iter() = default;
+
+            auto operator*() const -> filtered_string_view {
+                return parent_->fsv_.slice(first_, piece_.last, piece_.size);
+            }
+
+            auto operator++() -> iter&;
+            auto operator++(int) -> iter;
+
+            friend auto operator==(const iter& a, const iter& b) noexcept -> bool {
+                return a.parent_ == b.parent_ && a.done_ == b.done_ && (a.done_ || a.first_ == b.first_);
+            }
+
+            friend auto operator==(const iter& it, std::default_sentinel_t) noexcept -> bool {
+                return it.done_;
+            }
+
+        private:
+            friend class split_view;
+            iter(const split_view* parent, filtered_string_view::piece first) noexcept;
+
+            const split_view* parent_ = nullptr;
+            std::size_t first_ = 0;
+            filtered_string_view::piece piece_ = {};
+            bool done_ = true;
+        };
+
+    public:
+        split_view() = default;
+        split_view(filtered_string_view fsv, filtered_string_view tok);
+
+        auto begin() -> iter;
+        auto end() const noexcept -> std::default_sentinel_t {
+            return std::default_sentinel;
+        }
+
+    private:
+        filtered_string_view fsv_;
+        filtered_string_view tok_;
+        std::optional<filtered_string_view::piece> first_piece_;
+    };
+
+    auto lazy_split(const filtered_string_view& fsv, const filtered_string_view& tok) -> split_view;
+
 } // namespace fsv
 
 #endif // COMP6771_ASS2_FSV_H
\ No newline at end of file
@@ -0,0 +1,361 @@
+#include "./filtered_string_view.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "./bench_harness.h"
+
+#if defined(__linux__)
+#    include <sys/personality.h>
+#    include <sys/wait.h>
+#    include <unistd.h>
+#endif
+
+// Sweeps input size against filter selectivity and predicate kind, writes the timings as JSON and
+// compares them with a stored baseline.
+//
+//     filtered_string_view_matrix [--out FILE] [--baseline FILE] [--threshold RATIO]
+//                                 [--max-size BYTES] [--min-time MS] [--rounds N]
+//                                 [--noise-floor NS] [--update-baseline] [--baseline-runs N]
+//
+// Each cell is the median of --rounds batches of at least --min-time each, taken in rounds that
+// visit every cell of an input in turn. Cells more than half the threshold above their baseline get
+// a second set of rounds before the median is taken.
+//
+// Cells are compared with the baseline relative to the machine factor, the median ratio over all
+// cells, so that the machine running faster or slower than when the baseline was taken does not flag
+// every cell. Exits with status 1 when any cell, or the machine factor itself, is slower by more than
+// the threshold (0.3 means 30%); cells whose baseline is under the noise floor are reported but never
+// fail the run. --update-baseline rewrites the baseline file instead of comparing, keeping for each
+// cell the slowest of --baseline-runs sweeps. Baselines are only meaningful for the machine and
+// Release build that produced them.
+//
+// On Linux the program re-executes itself once with address space randomisation disabled, and
+// runs each baseline sweep in a child process of its own. Code, heap and physical page placement
+// alone move some 4 KiB cells by more than 30% from one process to the next, so a baseline from a
+// single process is too optimistic for some cells and too pessimistic for others.
+
+#if !defined(FSV_MATRIX_BASELINE)
+#    define FSV_MATRIX_BASELINE "bench/matrix_baseline.json"
+#endif
+
+namespace {
+    struct options {
+        std::string out = "filtered_string_view_matrix.json";
+        std::string baseline = FSV_MATRIX_BASELINE;
+        double threshold = 0.3;
+        std::size_t max_size = std::size_t{1} << 24;
+        std::chrono::milliseconds min_time{50};
+        int rounds = 7;
+        double noise_floor = 1000;
+        bool update_baseline = false;
+        int baseline_runs = 3;
+    };
+
+    auto parse(int argc, char** argv) -> options {
+        auto result = options{};
+        for (auto i = 1; i < argc; ++i) {
+            auto const flag = std::string_view{argv[i]};
+            if (flag == "--update-baseline") {
+                result.update_baseline = true;
+                continue;
+            }
+            if (i + 1 == argc) {
+                std::fprintf(stderr, "%s needs a value\n", argv[i]);
+                std::exit(2);
+            }
+            auto const value = argv[++i];
+            if (flag == "--out") {
+                result.out = value;
+            }
+            else if (flag == "--baseline") {
+                result.baseline = value;
+            }
+            else if (flag == "--threshold") {
+                result.threshold = std::strtod(value, nullptr);
+            }
+            else if (flag == "--max-size") {
+                result.max_size = std::min(std::strtoull(value, nullptr, 10), 1ULL << 30);
+            }
+            else if (flag == "--min-time") {
+                result.min_time = std::chrono::milliseconds{std::strtoll(value, nullptr, 10)};
+            }
+            else if (flag == "--rounds") {
+                result.rounds = std::max(1, std::atoi(value));
+            }
+            else if (flag == "--baseline-runs") {
+                result.baseline_runs = std::max(1, std::atoi(value));
+            }
+            else if (flag == "--noise-floor") {
+                result.noise_floor = std::strtod(value, nullptr);
+            }
+            else {
+                std::fprintf(stderr, "unknown option %s\n", flag.data());
+                std::exit(2);
+            }
+        }
+        return result;
+    }
+
+    using results = std::map<std::string, double>;
+
+    auto make_view(std::string_view kind, const std::string& text) -> fsv::filtered_string_view {
+        if (kind == "identity") {
+            return fsv::filtered_string_view{text};
+        }
+        if (kind == "table") {
+            return fsv::filtered_string_view{text, ~fsv::char_class::range('a', 'z')};
+        }
+        if (kind == "lambda") {
+            return fsv::filtered_string_view{text, fsv::bench::is_not_letter};
+        }
+        if (kind == "compose") {
+            // the extra filters accept every generated character, so the selectivity is unchanged
+            return fsv::compose(fsv::filtered_string_view{text},
+                                {fsv::bench::is_not_letter,
+                                 [](const char& c) { return c != '\0'; },
+                                 [](const char& c) { return c != '\n'; }});
+        }
+        // nested substr: a lambda view trimmed by one accepted character at each of three levels
+        auto view = fsv::filtered_string_view{text, fsv::bench::is_not_letter};
+        for (auto level = 0; level < 3; ++level) {
+            view = fsv::substr(view, view.empty() ? 0 : 1);
+        }
+        return view;
+    }
+
+    // the median of a non-empty set of samples
+    auto median(std::vector<double> samples) -> double {
+        auto const middle = samples.begin() + static_cast<std::ptrdiff_t>(samples.size() / 2);
+        std::nth_element(samples.begin(), middle, samples.end());
+        return *middle;
+    }
+
+    // one operation on one input, timed in batches of a fixed number of calls
+    struct cell {
+        std::string name;
+        std::function<std::chrono::nanoseconds(std::size_t)> batch;
+        std::size_t iterations;
+        std::vector<double> samples;
+    };
+
+    // runs opts.rounds rounds over cells; each round visits every cell in turn, so a burst of load
+    // elsewhere on the machine reaches only a few of any one cell's samples and the median passes over it
+    auto sample(const options& opts, const std::vector<cell*>& cells) -> void {
+        for (auto round = 0; round < opts.rounds; ++round) {
+            for (auto c : cells) {
+                auto const elapsed = c->batch(c->iterations);
+                c->samples.push_back(static_cast<double>(elapsed.count()) / static_cast<double>(c->iterations));
+            }
+        }
+    }
+
+    // baseline may be empty; cells well above it are measured again before their result is taken
+    auto sweep(const options& opts, const results& baseline) -> results {
+        auto out = results{};
+        for (auto size = std::size_t{1} << 12; size <= opts.max_size; size <<= 6) {
+            for (auto selectivity : {0.0, 0.01, 0.5, 0.99, 1.0}) {
+                auto const in = fsv::bench::make_input_pair(size, selectivity);
+                auto const& text = in.text;
+                auto const kinds = {"identity", "table", "lambda", "compose", "substr"};
+                // reserved so the cells can refer to the views for as long as the rounds run
+                auto views = std::vector<std::pair<fsv::filtered_string_view, fsv::filtered_string_view>>{};
+                views.reserve(kinds.size());
+                auto cells = std::vector<cell>{};
+                for (auto kind : kinds) {
+                    auto const& [s, other] = views.emplace_back(make_view(kind, text), make_view(kind, in.twin));
+                    // the calibration run sizes the batches so that each takes at least min_time
+                    auto const add = [&](const char* operation, auto op) {
+                        auto name = std::ostringstream{};
+                        name << operation << '/' << kind << '/' << selectivity * 100 << "%/" << size;
+                        auto const iterations = fsv::bench::measure(size, opts.min_time, op).iterations;
+                        auto const batch = [op](std::size_t n) { return fsv::bench::time_batch(n, op); };
+                        cells.push_back({name.str(), batch, iterations, {}});
+                    };
+                    add("size", [&text, kind] { fsv::bench::keep(make_view(kind, text).size()); });
+                    add("iterate", [&s = s] {
+                        auto sum = 0U;
+                        for (auto c : s) {
+                            sum += static_cast<unsigned char>(c);
+                        }
+                        fsv::bench::keep(sum);
+                    });
+                    add("equal", [&s = s, &other = other] { fsv::bench::keep(s == other); });
+                    add("to_string", [&s = s] { fsv::bench::keep(static_cast<std::string>(s)); });
+                }
+                auto all = std::vector<cell*>{};
+                for (auto& c : cells) {
+                    all.push_back(&c);
+                }
+                sample(opts, all);
+                auto suspects = std::vector<cell*>{};
+                for (auto& c : cells) {
+                    auto const base = baseline.find(c.name);
+                    if (base != baseline.end() && median(c.samples) > base->second * (1 + opts.threshold / 2)) {
+                        suspects.push_back(&c);
+                    }
+                }
+                sample(opts, suspects);
+                for (auto& c : cells) {
+                    auto const ns = median(std::move(c.samples));
+                    std::printf("%-40s %14.1f ns\n", c.name.c_str(), ns);
+                    out[c.name] = ns;
+                }
+            }
+        }
+        return out;
+    }
+
+    /**
+        JSON: a single object whose "results" member is an array of {"name": ..., "ns_per_op": ...}
+        objects. The reader only understands what the writer produces.
+    */
+    auto write(const std::string& path, const results& cells) -> bool {
+        auto file = std::ofstream{path};
+        file << "{\n  \"unit\": \"ns_per_op\",\n  \"results\": [\n";
+        auto first = true;
+        for (auto const& [name, ns] : cells) {
+            file << (first ? "" : ",\n") << "    {\"name\": \"" << name << "\", \"ns_per_op\": " << ns << '}';
+            first = false;
+        }
+        file << "\n  ]\n}\n";
+        return static_cast<bool>(file);
+    }
+
+    auto read(const std::string& path) -> results {
+        auto file = std::ifstream{path};
+        auto buffer = std::ostringstream{};
+        buffer << file.rdbuf();
+        auto const json = buffer.str();
+        auto cells = results{};
+        constexpr auto name_key = std::string_view{"\"name\": \""};
+        constexpr auto value_key = std::string_view{"\"ns_per_op\": "};
+        for (auto pos = json.find(name_key); pos != std::string::npos; pos = json.find(name_key, pos)) {
+            pos += name_key.size();
+            auto const name_end = json.find('"', pos);
+            auto const value = json.find(value_key, name_end);
+            if (name_end == std::string::npos || value == std::string::npos) {
+                break;
+            }
+            cells[json.substr(pos, name_end - pos)] = std::strtod(json.c_str() + value + value_key.size(), nullptr);
+            pos = value;
+        }
+        return cells;
+    }
+
+    // the median ratio of current to baseline over the cells above the noise floor, or 1 if none are
+    auto machine_factor(const results& current, const results& baseline, const options& opts) -> double {
+        auto ratios = std::vector<double>{};
+        for (auto const& [name, ns] : current) {
+            auto const base = baseline.find(name);
+            if (base != baseline.end() && base->second >= opts.noise_floor) {
+                ratios.push_back(ns / base->second);
+            }
+        }
+        return ratios.empty() ? 1 : median(std::move(ratios));
+    }
+
+    // the slowest result for each cell over opts.baseline_runs sweeps, each in a fresh process where possible
+    auto sweep_for_baseline(const options& opts) -> results {
+        auto slowest = results{};
+        for (auto run = 0; run < opts.baseline_runs; ++run) {
+            auto part = results{};
+#if defined(__linux__)
+            auto const path = opts.baseline + ".part";
+            std::fflush(stdout);
+            auto const child = fork();
+            if (child == 0) {
+                auto const written = write(path, sweep(opts, {}));
+                std::fflush(stdout);
+                std::_Exit(written ? 0 : 2);
+            }
+            auto status = 0;
+            if (child == -1 || waitpid(child, &status, 0) == -1 || status != 0) {
+                return {};
+            }
+            part = read(path);
+            std::remove(path.c_str());
+#else
+            part = sweep(opts, {});
+#endif
+            for (auto const& [name, ns] : part) {
+                slowest[name] = std::max(slowest[name], ns);
+            }
+        }
+        return slowest;
+    }
+
+    auto compare(const results& current, const results& baseline, const options& opts) -> int {
+        auto const factor = machine_factor(current, baseline, opts);
+        std::printf("machine factor x%.2f\n", factor);
+        auto regressions = 0;
+        if (factor > 1 + opts.threshold) {
+            std::printf("REGRESSION every cell is slower than baseline\n");
+            ++regressions;
+        }
+        for (auto const& [name, ns] : current) {
+            auto const base = baseline.find(name);
+            if (base == baseline.end() || base->second <= 0) {
+                continue;
+            }
+            auto const ratio = ns / base->second / factor;
+            if (ratio <= 1 + opts.threshold) {
+                continue;
+            }
+            // cells this cheap move by more than the threshold with the state of the caches alone
+            auto const noisy = base->second < opts.noise_floor;
+            std::printf("%s %-40s %12.1f ns -> %12.1f ns (x%.2f after the machine factor)\n",
+                        noisy ? "noisy     " : "REGRESSION",
+                        name.c_str(),
+                        base->second,
+                        ns,
+                        ratio);
+            regressions += noisy ? 0 : 1;
+        }
+        return regressions;
+    }
+} // namespace
+
+auto main(int argc, char** argv) -> int {
+#if defined(__linux__)
+    if (auto const persona = personality(0xFFFFFFFF); persona != -1 && (persona & ADDR_NO_RANDOMIZE) == 0) {
+        // on success this does not return; otherwise carry on with randomisation
+        if (personality(static_cast<unsigned long>(persona) | ADDR_NO_RANDOMIZE) != -1) {
+            execv("/proc/self/exe", argv);
+        }
+    }
+#endif
+    auto const opts = parse(argc, argv);
+#if !defined(__OPTIMIZE__)
+    std::fprintf(stderr, "warning: built without optimisation; configure with -DCMAKE_BUILD_TYPE=Release\n");
+#endif
+    auto const baseline = opts.update_baseline ? results{} : read(opts.baseline);
+    auto const current = opts.update_baseline ? sweep_for_baseline(opts) : sweep(opts, baseline);
+    if (current.empty() || !write(opts.update_baseline ? opts.baseline : opts.out, current)) {
+        std::fprintf(stderr, "could not write results\n");
+        return 2;
+    }
+    if (opts.update_baseline) {
+        std::printf("baseline written to %s\n", opts.baseline.c_str());
+        return 0;
+    }
+    if (baseline.empty()) {
+        std::printf("no baseline at %s; results written to %s\n", opts.baseline.c_str(), opts.out.c_str());
+        return 0;
+    }
+    auto const regressions = compare(current, baseline, opts);
+    std::printf("%d of %zu cells slower than baseline by more than %.0f%%\n",
+                regressions,
+                current.size(),
+                opts.threshold * 100);
+    return regressions == 0 ? 0 : 1;
+}
@@ -1,4 +1,7 @@
 #include "./filtered_string_view.h"
+#include "./basic_filtered_string_view.h"
+#include "./profile_scope.h"
+#include "./simd.h"
 #include <catch2/catch.hpp>
 #include <iostream>
 
@@ -403,3 +406,953 @@ TEST_CASE("NON-MEMBER FUNCTIONS") {
         CHECK(result == expected);
     }
 }
+
+TEST_CASE("RANK SELECT INDEX") {
+    auto str = std::string{};
+    for (auto i = 0; i < 3000; ++i) {
+        str += static_cast<char>('a' + i % 26);
+        if (i % 7 == 0) {
+            str += ' ';
+        }
+    }
+    auto pred = [](const char& c) { return c != ' ' && c != 'e'; };
+
+    SECTION("build_index - indexed lookups match scanning lookups") {
+        auto const plain = fsv::filtered_string_view{str, pred};
+        auto indexed = fsv::filtered_string_view{str, pred};
+        CHECK_FALSE(indexed.has_index());
+        indexed.build_index();
+        REQUIRE(indexed.has_index());
+
+        REQUIRE(indexed.size() == plain.size());
+        for (auto i = std::size_t{0}; i < plain.size(); ++i) {
+            REQUIRE(indexed[i] == plain[i]);
+            REQUIRE(&indexed.at(i) == &plain[i]);
+        }
+    }
+
+    SECTION("build_index - at out of range still throws") {
+        auto s = fsv::filtered_string_view{"wombat", [](const char& c) { return c != 'w'; }};
+        s.build_index();
+        CHECK(s.at(4) == 't');
+        CHECK_THROWS_AS(s.at(5), std::domain_error);
+    }
+
+    SECTION("build_index - empty and fully rejected views") {
+        auto empty = fsv::filtered_string_view{""};
+        empty.build_index();
+        CHECK(empty.size() == 0);
+        CHECK(empty.empty());
+
+        auto none = fsv::filtered_string_view{"rejected", [](const char&) { return false; }};
+        none.build_index();
+        CHECK(none.size() == 0);
+        CHECK_THROWS_AS(none.at(0), std::domain_error);
+    }
+
+    SECTION("build_index - index travels with copies and moves") {
+        auto s = fsv::filtered_string_view{str, pred};
+        s.build_index();
+        auto copy = s;
+        CHECK(copy.has_index());
+        auto moved = std::move(copy);
+        CHECK(moved.has_index());
+        CHECK(moved == s);
+    }
+}
+
+TEST_CASE("CACHED SIZE") {
+    auto calls = std::size_t{0};
+    auto counting = [&calls](const char& c) {
+        ++calls;
+        return c != '-';
+    };
+
+    SECTION("size - predicate runs once per character across repeated calls") {
+        auto s = fsv::filtered_string_view{"a-b-c-d", counting};
+        CHECK(s.size() == 4);
+        CHECK(s.size() == 4);
+        CHECK(calls == 7);
+    }
+
+    SECTION("size - memoised length is carried by copies and moves") {
+        auto s = fsv::filtered_string_view{"a-b-c-d", counting};
+        CHECK(s.size() == 4);
+        calls = 0;
+        auto copy = s;
+        auto moved = std::move(copy);
+        auto assigned = fsv::filtered_string_view{};
+        assigned = moved;
+        CHECK(copy.size() == 0);
+        CHECK(moved.size() == 4);
+        CHECK(assigned.size() == 4);
+        CHECK(calls == 0);
+    }
+
+    SECTION("size - substr knows its length") {
+        auto s = fsv::filtered_string_view{"a-b-c-d", counting};
+        auto sub = fsv::substr(s, 1, 2);
+        auto tail = fsv::substr(s, 4);
+        calls = 0;
+        CHECK(sub.size() == 2);
+        CHECK(tail.size() == 0);
+        CHECK(calls == 0);
+    }
+
+    SECTION("empty - stops at the first accepted character") {
+        auto s = fsv::filtered_string_view{"-abcdef", counting};
+        CHECK_FALSE(s.empty());
+        CHECK(calls == 2);
+    }
+
+    SECTION("equality - linear number of predicate calls") {
+        auto lhs = fsv::filtered_string_view{"a-b-c-d", counting};
+        auto rhs = fsv::filtered_string_view{"a-b-c-d", counting};
+        CHECK(lhs == rhs);
+        CHECK(calls <= 4 * 7);
+    }
+}
+
+TEST_CASE("BASIC FILTERED STRING VIEW") {
+    auto no_vowels = [](const char& c) { return !(c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u'); };
+
+    SECTION("default predicate accepts everything") {
+        auto s = fsv::basic_filtered_string_view{"kelpie"};
+        CHECK(s.size() == 6);
+        CHECK(static_cast<std::string>(s) == "kelpie");
+        CHECK(fsv::basic_filtered_string_view<>{}.empty());
+    }
+
+    SECTION("predicate type is deduced from the constructor") {
+        auto const str = std::string{"beagle"};
+        auto s = fsv::basic_filtered_string_view{str, no_vowels};
+        STATIC_REQUIRE(std::is_same_v<decltype(s)::predicate_type, decltype(no_vowels)>);
+        CHECK(s.size() == 3);
+        CHECK(s[1] == 'g');
+        CHECK(s.at(2) == 'l');
+        CHECK_THROWS_AS(s.at(3), std::domain_error);
+        CHECK(s.data() == str.data());
+    }
+
+    SECTION("stateless predicates take no space") {
+        STATIC_REQUIRE(sizeof(fsv::basic_filtered_string_view<>) == sizeof(const char*) + sizeof(std::size_t));
+    }
+
+    SECTION("iteration forwards and backwards") {
+        auto s = fsv::basic_filtered_string_view{"youtube", no_vowels};
+        CHECK(std::string(s.begin(), s.end()) == "ytb");
+        CHECK(std::string(s.rbegin(), s.rend()) == "bty");
+        CHECK(*std::prev(s.end()) == 'b');
+    }
+
+    SECTION("comparisons and output") {
+        auto a = fsv::basic_filtered_string_view{"b a n a n a s", [](const char& c) { return c != ' '; }};
+        auto b = fsv::basic_filtered_string_view{"bananas"};
+        CHECK(a == b);
+        CHECK(a < fsv::basic_filtered_string_view{"bananaz"});
+        CHECK(b > fsv::basic_filtered_string_view{"apples"});
+
+        // high bytes order above ASCII, as they do once converted to filtered_string_view
+        auto const high = fsv::basic_filtered_string_view{"\x80"};
+        auto const low = fsv::basic_filtered_string_view{"a"};
+        CHECK(high > low);
+        CHECK((high <=> low) == (fsv::filtered_string_view{high} <=> fsv::filtered_string_view{low}));
+
+        auto oss = std::ostringstream{};
+        oss << fsv::basic_filtered_string_view{"c++ > rust", no_vowels};
+        CHECK(oss.str() == "c++ > rst");
+    }
+
+    SECTION("converts to the type-erased filtered_string_view") {
+        auto s = fsv::basic_filtered_string_view{"border collie", no_vowels};
+        fsv::filtered_string_view erased = s;
+        CHECK(erased.data() == s.data());
+        CHECK(erased == fsv::filtered_string_view{"brdr cll"});
+        CHECK(fsv::split(s, fsv::filtered_string_view{" "}).size() == 2);
+    }
+}
+
+TEST_CASE("CHAR CLASS") {
+    SECTION("membership of the predefined classes") {
+        CHECK(fsv::char_class::whitespace().contains('\t'));
+        CHECK_FALSE(fsv::char_class::whitespace().contains('x'));
+        CHECK(fsv::char_class::alnum().contains('Q'));
+        CHECK(fsv::char_class::alnum().contains('7'));
+        CHECK_FALSE(fsv::char_class::alnum().contains('_'));
+        CHECK(fsv::char_class::control().contains('\x7F'));
+        CHECK(fsv::char_class::control().contains('\0'));
+        CHECK_FALSE(fsv::char_class::control().contains(' '));
+        CHECK(fsv::char_class::all().contains('\xFF'));
+        CHECK_FALSE(fsv::char_class{}.contains('\xFF'));
+        CHECK((~fsv::char_class::digit()).contains('a'));
+        CHECK((fsv::char_class::alpha() & fsv::char_class{"abc123"}) == fsv::char_class{"cab"});
+    }
+
+    // long enough to cover full 64-byte blocks as well as the scalar tail
+    auto text = std::string{};
+    for (auto i = 0; i < 1000; ++i) {
+        text += static_cast<char>((i * 37 + i / 3) % 256);
+    }
+    auto const cls = ~fsv::char_class::whitespace() & ~fsv::char_class::control();
+    auto const lambda = [cls](const char& c) { return cls.contains(c); };
+
+    SECTION("table-driven views agree with the same predicate as a lambda") {
+        auto const table = fsv::filtered_string_view{text, cls};
+        auto const plain = fsv::filtered_string_view{text, lambda};
+        CHECK(table.size() == plain.size());
+        CHECK(std::string(table.begin(), table.end()) == std::string(plain.begin(), plain.end()));
+        CHECK(std::vector<char>(table.crbegin(), table.crend()) == std::vector<char>(plain.crbegin(), plain.crend()));
+    }
+
+    SECTION("string conversion and output") {
+        auto table = fsv::filtered_string_view{text, cls};
+        auto plain = fsv::filtered_string_view{text, lambda};
+        auto const expected = static_cast<std::string>(plain);
+        CHECK(static_cast<std::string>(table) == expected);
+
+        auto oss = std::ostringstream{};
+        oss << table;
+        CHECK(oss.str() == expected);
+    }
+
+    SECTION("sparse classes skip long rejected stretches") {
+        auto s = std::string(300, ' ') + "4" + std::string(200, '.') + "2";
+        auto digits = fsv::filtered_string_view{s, fsv::char_class::digit()};
+        CHECK(digits.size() == 2);
+        CHECK(static_cast<std::string>(digits) == "42");
+        CHECK(*digits.begin() == '4');
+        CHECK(*std::next(digits.begin()) == '2');
+        CHECK(std::next(digits.begin(), 2) == digits.end());
+    }
+
+    SECTION("empty and all-rejecting views") {
+        auto const xs = std::string(100, 'x');
+        auto none = fsv::filtered_string_view{xs, fsv::char_class{}};
+        CHECK(none.size() == 0);
+        CHECK(none.empty());
+        CHECK(none.begin() == none.end());
+        CHECK(static_cast<std::string>(none).empty());
+    }
+}
+
+TEST_CASE("PURE PREDICATES") {
+    auto const is_vowel = [](char c) { return c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u'; };
+
+    SECTION("pure probes each byte value once") {
+        auto calls = 0;
+        auto cls = fsv::pure([&calls](char c) {
+            ++calls;
+            return c == '!';
+        });
+        CHECK(calls == 256);
+        CHECK(cls == fsv::char_class{"!"});
+    }
+
+    SECTION("pure predicates are usable at compile time") {
+        constexpr auto vowels = fsv::pure([](char c) { return c == 'a' || c == 'e'; });
+        STATIC_REQUIRE(vowels.contains('e'));
+        STATIC_REQUIRE_FALSE(vowels.contains('i'));
+    }
+
+    SECTION("views built from a pure predicate use its table") {
+        auto s = fsv::filtered_string_view{"sequoia", fsv::pure(is_vowel)};
+        CHECK(s.predicate().target<fsv::char_class>() != nullptr);
+        CHECK(static_cast<std::string>(s) == "euoia");
+    }
+
+    SECTION("compose of pure filters stays a table") {
+        auto base = fsv::filtered_string_view{"Compose 42 Filters!"};
+        // pure probes every byte value, negative chars included, which std::isalpha must not be given
+        auto const is_alpha = [](char c) { return std::isalpha(static_cast<unsigned char>(c)) != 0; };
+        auto filts = std::vector<fsv::filter>{fsv::pure([](char c) { return c != ' '; }), fsv::pure(is_alpha)};
+        auto composed = fsv::compose(base, filts);
+        CHECK(composed.predicate().target<fsv::char_class>() != nullptr);
+        CHECK(static_cast<std::string>(composed) == "ComposeFilters");
+    }
+
+    SECTION("compose with an impure filter falls back to calling each filter") {
+        auto base = fsv::filtered_string_view{"aXbYc"};
+        auto filts = std::vector<fsv::filter>{fsv::pure(is_vowel), [](const char&) { return true; }};
+        auto composed = fsv::compose(base, filts);
+        CHECK(composed.predicate().target<fsv::char_class>() == nullptr);
+        CHECK(static_cast<std::string>(composed) == "a");
+    }
+
+    SECTION("substr of a pure view keeps filtering by table") {
+        auto s = fsv::filtered_string_view{"abracadabra", fsv::pure([](char c) { return c != 'a'; })};
+        auto oss = std::ostringstream{};
+        oss << fsv::substr(s, 1, 4);
+        CHECK(oss.str() == "rcdb");
+    }
+}
+
+TEST_CASE("BOUNDED SUBSTR") {
+    auto calls = std::size_t{0};
+    auto counting = [&calls](const char& c) {
+        ++calls;
+        return c != '_';
+    };
+    auto const str = std::string{"_a_b_c_d_e_f_g_h_i_j_k_l_m_n_o_p_"};
+
+    SECTION("nested substr keeps per-character cost constant") {
+        auto s = fsv::filtered_string_view{str, counting};
+        for (auto i = 0; i < 10; ++i) {
+            s = fsv::substr(s, 1);
+        }
+        CHECK(static_cast<std::string>(s) == "klmnop");
+        calls = 0;
+        CHECK(static_cast<std::string>(s) == "klmnop");
+        CHECK(calls <= 12);
+    }
+
+    SECTION("substr shares the base buffer and narrows the bounds") {
+        auto s = fsv::filtered_string_view{str, counting};
+        auto sub = fsv::substr(fsv::substr(s, 2, 10), 3, 4);
+        CHECK(sub.data() == str.data());
+        CHECK(sub.size() == 4);
+        CHECK(static_cast<std::string>(sub) == "fghi");
+        CHECK(sub[3] == 'i');
+        CHECK(sub.at(0) == 'f');
+        CHECK(std::string(sub.rbegin(), sub.rend()) == "ihgf");
+        CHECK(fsv::substr(sub, 4).empty());
+        CHECK_THROWS_AS(fsv::substr(sub, 5), std::out_of_range);
+    }
+
+    SECTION("substr of an indexed view reuses the index") {
+        auto s = fsv::filtered_string_view{str, counting};
+        s.build_index();
+        auto sub = fsv::substr(s, 5, 6);
+        CHECK(sub.has_index());
+        calls = 0;
+        CHECK(sub.size() == 6);
+        CHECK(sub[0] == 'f');
+        CHECK(sub.at(5) == 'k');
+        auto const middle = fsv::substr(sub, 2, 2);
+        CHECK(calls == 0);
+        CHECK(middle == fsv::filtered_string_view{"hi"});
+    }
+
+    SECTION("compose keeps the bounds of a sliced view") {
+        auto s = fsv::substr(fsv::filtered_string_view{"hello world"}, 6);
+        auto composed = fsv::compose(s, {[](const char& c) { return c != 'o'; }});
+        CHECK(static_cast<std::string>(composed) == "wrld");
+    }
+}
+
+TEST_CASE("SINGLE PASS SPLIT") {
+    SECTION("split - pieces are bounded views with known sizes") {
+        auto const str = std::string{"GET /index.html HTTP/1.1"};
+        auto s = fsv::filtered_string_view{str};
+        auto result = fsv::split(s, fsv::filtered_string_view{" "});
+        auto expected = std::vector<fsv::filtered_string_view>{"GET", "/index.html", "HTTP/1.1"};
+        REQUIRE(result == expected);
+        for (const auto& piece : result) {
+            CHECK(piece.data() == str.data());
+        }
+        CHECK(result[1].size() == 11);
+    }
+
+    SECTION("split - multi-character token with filtering on both sides") {
+        auto s = fsv::filtered_string_view{"a, b,, c ,,d", [](const char& c) { return c != ' '; }};
+        auto tok = fsv::filtered_string_view{",,", [](const char& c) { return c == ','; }};
+        auto result = fsv::split(s, tok);
+        auto expected = std::vector<fsv::filtered_string_view>{"a,b", "c", "d"};
+        CHECK(result == expected);
+    }
+
+    SECTION("split - partial token matches do not consume characters") {
+        auto s = fsv::filtered_string_view{"aabab"};
+        auto result = fsv::split(s, fsv::filtered_string_view{"ab"});
+        auto expected = std::vector<fsv::filtered_string_view>{"a", "", ""};
+        CHECK(result == expected);
+    }
+
+    SECTION("split - linear number of predicate calls") {
+        auto calls = std::size_t{0};
+        auto str = std::string{};
+        for (auto i = 0; i < 500; ++i) {
+            str += "field;";
+        }
+        auto s = fsv::filtered_string_view{str, [&calls](const char&) {
+                                               ++calls;
+                                               return true;
+                                           }};
+        auto result = fsv::split(s, fsv::filtered_string_view{";"});
+        CHECK(result.size() == 501);
+        CHECK(calls <= 3 * str.size());
+    }
+}
+
+TEST_CASE("LAZY SPLIT") {
+    STATIC_REQUIRE(std::ranges::forward_range<fsv::split_view>);
+    STATIC_REQUIRE(std::ranges::view<fsv::split_view>);
+
+    auto const line = std::string{"2024-01-01 12:00:00 INFO scrubber request accepted"};
+    auto const space = fsv::filtered_string_view{" "};
+
+    SECTION("yields the same fields as split") {
+        auto s = fsv::filtered_string_view{line};
+        auto lazy = std::vector<fsv::filtered_string_view>{};
+        for (auto field : fsv::lazy_split(s, space)) {
+            lazy.push_back(field);
+        }
+        CHECK(lazy == fsv::split(s, space));
+    }
+
+    SECTION("only scans as far as the caller reads") {
+        auto calls = std::size_t{0};
+        auto s = fsv::filtered_string_view{line, [&calls](const char&) {
+                                               ++calls;
+                                               return true;
+                                           }};
+        auto third = *std::ranges::next(fsv::lazy_split(s, space).begin(), 2);
+        // "2024-01-01 12:00:00 INFO" plus the delimiter after it, and one recheck per field boundary
+        CHECK(calls <= 25 + 3);
+        CHECK(third == "INFO");
+    }
+
+    SECTION("begin finds the first field once") {
+        auto calls = std::size_t{0};
+        auto const padded = std::string(1000, 'x') + " tail";
+        auto s = fsv::filtered_string_view{padded, [&calls](const char&) {
+                                               ++calls;
+                                               return true;
+                                           }};
+        auto fields = fsv::lazy_split(s, space);
+        CHECK(std::ranges::distance(fields) == 2);
+        auto const scanned = calls;
+        auto const first = *fields.begin();
+        CHECK(calls == scanned);
+        CHECK(first.size() == 1000);
+    }
+
+    SECTION("composes with std::ranges algorithms and views") {
+        auto s = fsv::filtered_string_view{line};
+        auto fields = fsv::lazy_split(s, space);
+        auto first_two = fields | std::views::take(2);
+        CHECK(std::ranges::distance(first_two) == 2);
+        auto it = std::ranges::find(fields, fsv::filtered_string_view{"scrubber"});
+        REQUIRE(it != fields.end());
+        CHECK(*std::ranges::next(it) == "request");
+        CHECK(std::ranges::distance(fields) == 6);
+    }
+
+    SECTION("empty input and token behave like split") {
+        auto empty = fsv::lazy_split(fsv::filtered_string_view{""}, space);
+        CHECK(std::ranges::distance(empty) == 1);
+        auto whole = fsv::lazy_split(fsv::filtered_string_view{"fishing"}, fsv::filtered_string_view{""});
+        REQUIRE(std::ranges::distance(whole) == 1);
+        CHECK(*whole.begin() == "fishing");
+    }
+}
+
+TEST_CASE("RUNS") {
+    auto const str = std::string{"\x01log\x02line\x03\x04with\x7F control"};
+    auto const expected = std::vector<std::string_view>{"log", "line", "with", " control"};
+
+    SECTION("runs - yields maximal accepted slices of the base buffer") {
+        auto s = fsv::filtered_string_view{str, [](const char& c) { return !std::iscntrl(c); }};
+        auto runs = std::vector<std::string_view>{};
+        for (auto run : s.runs()) {
+            CHECK(run.data() >= str.data());
+            CHECK(run.data() + run.size() <= str.data() + str.size());
+            runs.push_back(run);
+        }
+        CHECK(runs == expected);
+        STATIC_REQUIRE(std::ranges::forward_range<decltype(s.runs())>);
+    }
+
+    SECTION("for_each_run - table and lambda predicates agree") {
+        auto table = fsv::filtered_string_view{str, ~fsv::char_class::control()};
+        auto runs = std::vector<std::string_view>{};
+        table.for_each_run([&runs](std::string_view run) { runs.push_back(run); });
+        CHECK(runs == expected);
+        CHECK(std::vector<std::string_view>(table.runs().begin(), table.runs().end()) == expected);
+    }
+
+    SECTION("runs - unfiltered view is a single run") {
+        auto s = fsv::filtered_string_view{str};
+        auto runs = s.runs();
+        REQUIRE(std::ranges::distance(runs) == 1);
+        CHECK(*runs.begin() == std::string_view{str});
+    }
+
+    SECTION("runs - respect substr bounds") {
+        auto s = fsv::substr(fsv::filtered_string_view{str, ~fsv::char_class::control()}, 5, 6);
+        auto runs = std::vector<std::string_view>{};
+        s.for_each_run([&runs](std::string_view run) { runs.push_back(run); });
+        CHECK(runs == std::vector<std::string_view>{"ne", "with"});
+    }
+
+    SECTION("runs - empty views have none") {
+        auto s = fsv::filtered_string_view{str, [](const char&) { return false; }};
+        CHECK(s.runs().empty());
+        auto calls = 0;
+        fsv::filtered_string_view{}.for_each_run([&calls](std::string_view) { ++calls; });
+        CHECK(calls == 0);
+    }
+}
+
+TEST_CASE("BULK OUTPUT") {
+    auto const str = std::string{"status=200\tbytes=5120\tpath=/api"};
+    auto tabs_to_nothing = [](const char& c) { return c != '\t'; };
+
+    SECTION("operator<< writes every run") {
+        auto oss = std::ostringstream{};
+        oss << fsv::filtered_string_view{str, tabs_to_nothing} << '|' << fsv::filtered_string_view{str};
+        CHECK(oss.str() == "status=200bytes=5120path=/api|" + str);
+    }
+
+    SECTION("operator<< of a sliced view") {
+        auto oss = std::ostringstream{};
+        oss << fsv::substr(fsv::filtered_string_view{str, tabs_to_nothing}, 7, 9);
+        CHECK(oss.str() == "200bytes=");
+    }
+}
+
+TEST_CASE("COPY TO") {
+    auto str = std::string{};
+    for (auto i = 0; i < 1000; ++i) {
+        str.push_back(static_cast<char>((i * 37 + i / 7) % 256));
+    }
+    auto const is_digit = [](const char& c) { return c >= '0' && c <= '9'; };
+    auto expected = std::string{};
+    std::copy_if(str.begin(), str.end(), std::back_inserter(expected), is_digit);
+
+    SECTION("a char_class filter compacts into the whole buffer") {
+        auto s = fsv::filtered_string_view{str, fsv::char_class::digit()};
+        auto buffer = std::string(expected.size(), '\0');
+        CHECK(s.copy_to(buffer.data(), buffer.size()) == expected.size());
+        CHECK(buffer == expected);
+        CHECK(static_cast<std::string>(s) == expected);
+    }
+
+    SECTION("copying stops at the capacity") {
+        for (auto filter : {fsv::filter{fsv::char_class::digit()}, fsv::filter{is_digit}}) {
+            auto s = fsv::filtered_string_view{str, filter};
+            for (auto capacity : {std::size_t{0}, std::size_t{1}, std::size_t{5}, expected.size() - 1}) {
+                auto buffer = std::string(capacity + 8, '#');
+                CHECK(s.copy_to(buffer.data(), capacity) == capacity);
+                CHECK(buffer.substr(0, capacity) == expected.substr(0, capacity));
+                CHECK(buffer.substr(capacity) == "########");
+            }
+        }
+    }
+
+    SECTION("accepting everything or nothing") {
+        auto buffer = std::string(str.size(), '\0');
+        auto const all = fsv::filtered_string_view{str, fsv::char_class::all()};
+        CHECK(all.copy_to(buffer.data(), buffer.size()) == str.size());
+        CHECK(buffer == str);
+        CHECK(fsv::filtered_string_view{str, fsv::char_class{}}.copy_to(buffer.data(), buffer.size()) == 0);
+    }
+
+    SECTION("a substr copies only its bounds") {
+        auto s = fsv::substr(fsv::filtered_string_view{str, fsv::char_class::digit()}, 3, 30);
+        auto buffer = std::string(100, '\0');
+        CHECK(s.copy_to(buffer.data(), buffer.size()) == 30);
+        CHECK(buffer.substr(0, 30) == expected.substr(3, 30));
+    }
+}
+
+TEST_CASE("THREE WAY COMPARISON") {
+    auto const no_dashes = [](const char& c) { return c != '-'; };
+
+    SECTION("runs that split at different places compare by their characters") {
+        auto a = fsv::filtered_string_view{"ab-cde-f-g", no_dashes};
+        auto b = fsv::filtered_string_view{"a-bcd-efg", no_dashes};
+        CHECK(a == b);
+        CHECK((a <=> b) == std::strong_ordering::equal);
+        auto c = fsv::filtered_string_view{"abc-dex", no_dashes};
+        CHECK((a <=> c) == std::strong_ordering::less);
+        CHECK((c <=> a) == std::strong_ordering::greater);
+        CHECK(a != c);
+    }
+
+    SECTION("a proper prefix orders first") {
+        auto a = fsv::filtered_string_view{"ab-c", no_dashes};
+        auto b = fsv::filtered_string_view{"a-bcd", no_dashes};
+        CHECK(a < b);
+        CHECK(b > a);
+        CHECK((fsv::filtered_string_view{} <=> a) == std::strong_ordering::less);
+        auto const dashes = fsv::filtered_string_view{"---", no_dashes};
+        CHECK((fsv::filtered_string_view{} <=> dashes) == std::strong_ordering::equal);
+    }
+
+    SECTION("characters compare as unsigned char, like std::string") {
+        auto high = std::string{"\x80z"};
+        auto low = std::string{"az"};
+        CHECK(fsv::filtered_string_view{high} > fsv::filtered_string_view{low});
+        CHECK(fsv::filtered_string_view{high, no_dashes} > fsv::filtered_string_view{low, no_dashes});
+        CHECK((high <=> low) == (fsv::filtered_string_view{high, no_dashes} <=> fsv::filtered_string_view{low}));
+    }
+
+    SECTION("sorting and deduplicating agrees with the materialised strings") {
+        auto const words =
+            std::vector<std::string>{"b-an-ana", "ban-ana", "apple", "-apple-", "ba", "", "a--", "banana-s"};
+        auto views = std::vector<fsv::filtered_string_view>{};
+        auto strings = std::vector<std::string>{};
+        for (auto const& word : words) {
+            views.emplace_back(word, no_dashes);
+            views.emplace_back(word, fsv::char_class{"-"});
+            views.emplace_back(word);
+        }
+        std::sort(views.begin(), views.end());
+        views.erase(std::unique(views.begin(), views.end()), views.end());
+        for (auto const& view : views) {
+            strings.push_back(static_cast<std::string>(view));
+        }
+        CHECK(std::is_sorted(strings.begin(), strings.end()));
+        CHECK(std::adjacent_find(strings.begin(), strings.end()) == strings.end());
+        CHECK(strings.front() == "");
+        CHECK(std::count(strings.begin(), strings.end(), "banana") == 1);
+    }
+}
+
+TEST_CASE("IDENTITY FAST PATHS") {
+    auto const str = std::string{"key=value;;other=thing;last"};
+    auto const everything = [](const char&) { return true; };
+    auto const plain = fsv::filtered_string_view{str};
+    auto const filtered = fsv::filtered_string_view{str, everything};
+
+    SECTION("an unfiltered view agrees with the same view through a user predicate") {
+        CHECK(plain.size() == filtered.size());
+        CHECK(static_cast<std::string>(plain) == str);
+        CHECK(plain[4] == 'v');
+        CHECK(plain == filtered);
+        auto reversed = fsv::filtered_string_view{plain};
+        CHECK(std::equal(reversed.rbegin(), reversed.rend(), str.rbegin(), str.rend()));
+        CHECK_THROWS_AS(fsv::filtered_string_view{plain}.at(str.size()), std::domain_error);
+        CHECK(fsv::filtered_string_view{plain}.at(str.size() - 1) == 't');
+    }
+
+    SECTION("substr and split of an unfiltered view") {
+        CHECK(fsv::substr(plain, 4, 5) == fsv::filtered_string_view{"value"});
+        CHECK(fsv::substr(plain, 23) == fsv::filtered_string_view{"last"});
+        auto const pieces = fsv::split(plain, fsv::filtered_string_view{";"});
+        auto const expected = std::vector<std::string>{"key=value", "", "other=thing", "last"};
+        REQUIRE(pieces.size() == expected.size());
+        for (auto i = std::size_t{0}; i < pieces.size(); ++i) {
+            CHECK(static_cast<std::string>(pieces[i]) == expected[i]);
+            CHECK(pieces[i] == fsv::split(filtered, fsv::filtered_string_view{";"})[i]);
+        }
+        auto const tail = fsv::split(plain, fsv::filtered_string_view{"last"});
+        REQUIRE(tail.size() == 2);
+        CHECK(tail[1].empty());
+    }
+
+    SECTION("a char_class accepting every byte is treated as unfiltered") {
+        auto const all = fsv::filtered_string_view{str, fsv::char_class::all()};
+        CHECK(all.size() == str.size());
+        CHECK(all == plain);
+        CHECK(static_cast<std::string>(fsv::substr(all, 10, 3)) == ";ot");
+    }
+
+    SECTION("a view without a buffer copies nothing") {
+        auto const empty = fsv::filtered_string_view{};
+        CHECK(static_cast<std::string>(empty).empty());
+        CHECK(empty.copy_to(nullptr, 0) == 0);
+        auto moved = fsv::filtered_string_view{str};
+        auto const taken = std::move(moved);
+        CHECK(static_cast<std::string>(moved).empty());
+        CHECK(taken.size() == str.size());
+    }
+
+    SECTION("mixing unfiltered and filtered views") {
+        auto const no_semicolons = fsv::filtered_string_view{str, [](const char& c) { return c != ';'; }};
+        CHECK(plain < no_semicolons);
+        auto const pieces = fsv::split(no_semicolons, fsv::filtered_string_view{"=t"});
+        REQUIRE(pieces.size() == 2);
+        CHECK(static_cast<std::string>(pieces[0]) == "key=valueother");
+        CHECK(static_cast<std::string>(pieces[1]) == "hinglast");
+    }
+}
+
+TEST_CASE("SHARED PREDICATE") {
+    auto const str = std::string{"a1,b22,c333"};
+    auto const big = std::array<char, 64>{'1', '2', '3'};
+    auto const not_in_big = [big](const char& c) { return std::find(big.begin(), big.end(), c) == big.end(); };
+    auto const s = fsv::filtered_string_view{str, not_in_big};
+
+    SECTION("copies, moves and slices refer to the same predicate") {
+        auto copy = s;
+        CHECK(&copy.predicate() == &s.predicate());
+        auto moved = std::move(copy);
+        CHECK(&moved.predicate() == &s.predicate());
+        auto assigned = fsv::filtered_string_view{};
+        assigned = moved;
+        CHECK(&assigned.predicate() == &s.predicate());
+        CHECK(&fsv::substr(s, 1, 2).predicate() == &s.predicate());
+        for (auto const& piece : fsv::split(s, fsv::filtered_string_view{","})) {
+            CHECK(&piece.predicate() == &s.predicate());
+        }
+    }
+
+    SECTION("the predicate outlives the view that created it") {
+        auto pieces = std::vector<fsv::filtered_string_view>{};
+        {
+            auto local = fsv::filtered_string_view{str, [big](const char& c) { return c != ',' && c != big[1]; }};
+            pieces = fsv::split(local, fsv::filtered_string_view{"b"});
+        }
+        REQUIRE(pieces.size() == 2);
+        CHECK(static_cast<std::string>(pieces[0]) == "a1");
+        CHECK(static_cast<std::string>(pieces[1]) == "c333");
+    }
+
+    SECTION("unfiltered views share one predicate") {
+        CHECK(&fsv::filtered_string_view{}.predicate() == &fsv::filtered_string_view{str}.predicate());
+    }
+
+    SECTION("a moved-from view is empty and unfiltered") {
+        auto copy = s;
+        auto moved = std::move(copy);
+        CHECK(copy.empty());
+        CHECK(copy.predicate()('x'));
+        CHECK(moved == s);
+    }
+}
+
+TEST_CASE("COMPACT LAYOUT") {
+    SECTION("a view is a pointer and four 32-bit fields") {
+        CHECK(sizeof(fsv::filtered_string_view) == sizeof(const char*) + 4 * sizeof(std::uint32_t));
+    }
+
+    SECTION("building an index does not affect views already sharing the predicate") {
+        auto const str = std::string{"x1y2z3"};
+        auto s = fsv::filtered_string_view{str, fsv::char_class::digit()};
+        auto const earlier = s;
+        s.build_index();
+        CHECK(s.has_index());
+        CHECK_FALSE(earlier.has_index());
+        CHECK(s == earlier);
+        CHECK(fsv::substr(s, 1).has_index());
+        CHECK(s.predicate().target<fsv::char_class>() != nullptr);
+    }
+
+    SECTION("predicates released by dead views are reused") {
+        auto const str = std::string{"recycled predicates"};
+        for (auto round = 0; round < 1000; ++round) {
+            auto const vowel = static_cast<char>("aeiou"[round % 5]);
+            auto s = fsv::filtered_string_view{str, [vowel](const char& c) { return c != vowel; }};
+            auto pieces = fsv::split(s, fsv::filtered_string_view{" "});
+            REQUIRE(pieces.size() == 2);
+            CHECK(pieces[1].predicate()(vowel) == false);
+        }
+    }
+}
+
+TEST_CASE("SPARSE ITERATION") {
+    // digits scattered through long stretches of prose, so both directions cross whole blocks
+    auto str = std::string{};
+    for (auto i = 0; i < 40; ++i) {
+        str += std::string(static_cast<std::size_t>(i * 7 % 150), 'x');
+        str.push_back(static_cast<char>('0' + i % 10));
+    }
+    str += std::string(200, 'y');
+    auto expected = std::string{};
+    std::copy_if(str.begin(), str.end(), std::back_inserter(expected), [](char c) { return c >= '0' && c <= '9'; });
+
+    auto s = fsv::filtered_string_view{str, fsv::char_class::digit()};
+    auto const scanned = fsv::filtered_string_view{str, [](const char& c) { return c >= '0' && c <= '9'; }};
+
+    SECTION("forwards") {
+        CHECK(std::equal(s.begin(), s.end(), expected.begin(), expected.end()));
+    }
+
+    SECTION("backwards") {
+        CHECK(std::equal(s.rbegin(), s.rend(), expected.rbegin(), expected.rend()));
+        auto copy = scanned;
+        CHECK(std::equal(copy.rbegin(), copy.rend(), expected.rbegin(), expected.rend()));
+    }
+
+    SECTION("decrementing from the end of a slice stays inside it") {
+        auto sub = fsv::substr(s, 5, 10);
+        auto it = sub.end();
+        for (auto i = std::size_t{10}; i > 0; --i) {
+            --it;
+            CHECK(*it == expected[5 + i - 1]);
+        }
+        CHECK(it == sub.begin());
+    }
+}
+
+TEST_CASE("INDEXED RANGE") {
+    auto const str = std::string{"a1b1c2--3x5y5z8..9"};
+    auto s = fsv::filtered_string_view{str, fsv::char_class::digit()};
+
+    SECTION("requires an index") {
+        CHECK_THROWS_AS(s.indexed(), std::logic_error);
+    }
+
+    SECTION("is a sized random-access range over the filtered characters") {
+        s.build_index();
+        auto const range = s.indexed();
+        STATIC_REQUIRE(std::ranges::random_access_range<decltype(range)>);
+        STATIC_REQUIRE(std::random_access_iterator<fsv::filtered_string_view::indexed_iterator>);
+        CHECK(std::ranges::size(range) == 8);
+        CHECK(std::ranges::equal(range, std::string_view{"11235589"}));
+        CHECK(range[4] == '5');
+        CHECK(range.end() - range.begin() == 8);
+        CHECK(*(range.end() - 1) == '9');
+    }
+
+    SECTION("binary search over a sorted filtered view") {
+        s.build_index();
+        auto const range = s.indexed();
+        auto const five = std::lower_bound(range.begin(), range.end(), '5');
+        CHECK(five - range.begin() == 4);
+        CHECK(std::upper_bound(range.begin(), range.end(), '5') - five == 2);
+        CHECK(&*five == &str[10]);
+    }
+
+    SECTION("a slice of an indexed view walks only its own characters") {
+        s.build_index();
+        auto const sub = fsv::substr(s, 2, 4);
+        CHECK(std::ranges::equal(sub.indexed(), std::string_view{"2355"}));
+        CHECK(std::ranges::distance(sub.indexed()) == 4);
+    }
+}
+
+TEST_CASE("RANGES") {
+    using view = fsv::filtered_string_view;
+    STATIC_REQUIRE(std::ranges::view<view>);
+    STATIC_REQUIRE(std::ranges::bidirectional_range<view>);
+    STATIC_REQUIRE(std::ranges::common_range<view>);
+    STATIC_REQUIRE(std::ranges::sized_range<view>);
+    STATIC_REQUIRE_FALSE(std::ranges::borrowed_range<view>);
+    STATIC_REQUIRE(std::same_as<std::iter_value_t<view::iterator>, char>);
+
+    auto const str = std::string{"The 3 quick brown foxes"};
+    auto const s = view{str, [](const char& c) { return c != ' '; }};
+
+    SECTION("range algorithms") {
+        CHECK(std::ranges::size(s) == 19);
+        CHECK(*std::ranges::find(s, 'q') == 'q');
+        CHECK(std::ranges::find(s, 'q').operator->() == &str[6]);
+        auto out = std::string{};
+        std::ranges::copy(s, std::back_inserter(out));
+        CHECK(out == "The3quickbrownfoxes");
+        CHECK(s.front() == 'T');
+        CHECK(s.back() == 's');
+    }
+
+    SECTION("views compose without materialising") {
+        auto taken = std::string{};
+        std::ranges::copy(s | std::views::take(4), std::back_inserter(taken));
+        CHECK(taken == "The3");
+        auto reversed = std::string{};
+        std::ranges::copy(s | std::views::reverse | std::views::take(5), std::back_inserter(reversed));
+        CHECK(reversed == "sexof");
+        CHECK(std::ranges::distance(s | std::views::filter([](char c) { return c == 'o'; })) == 2);
+    }
+}
+
+TEST_CASE("SELF-CONTAINED ITERATORS") {
+    STATIC_REQUIRE(std::is_trivially_copyable_v<fsv::filtered_string_view::iterator>);
+
+    auto const str = std::string{"r-e-l-o-c-a-t-e"};
+    auto const no_dashes = [](const char& c) { return c != '-'; };
+
+    SECTION("iterators keep working after their view moves") {
+        auto views = std::vector<fsv::filtered_string_view>{};
+        views.emplace_back(str, no_dashes);
+        auto it = views.front().begin();
+        auto const last = views.front().end();
+        for (auto i = 0; i < 100; ++i) {
+            views.emplace_back(str);
+        }
+        auto out = std::string{};
+        for (; it != last; ++it) {
+            out.push_back(*it);
+        }
+        CHECK(out == "relocate");
+    }
+
+    SECTION("iterators of copies of a view compare equal") {
+        auto const s = fsv::filtered_string_view{str, no_dashes};
+        auto const copy = s;
+        CHECK(s.begin() == copy.begin());
+        CHECK(std::next(s.begin(), 3) == std::prev(copy.end(), 5));
+    }
+}
+
+TEST_CASE("PROFILE SCOPE") {
+    auto const str = std::string(4096, 'a') + std::string(4096, '1');
+    auto const s = fsv::filtered_string_view{str, [](const char& c) { return c != 'a'; }};
+
+    SECTION("profiled code runs unchanged whether or not counters are available") {
+        auto scope = fsv::profile_scope{};
+        CHECK(s.size() == 4096);
+        auto const counts = scope.stop();
+        for (auto const& value : counts.values) {
+            CHECK((value.has_value() ? scope.available() : true));
+        }
+        if (auto const cycles = counts[fsv::hardware_counter::cycles]) {
+            CHECK(*cycles > 0);
+        }
+    }
+
+    SECTION("stopping twice returns the first counts") {
+        auto scope = fsv::profile_scope{};
+        CHECK(static_cast<std::string>(s).size() == 4096);
+        auto const first = scope.stop();
+        CHECK(fsv::split(s, fsv::filtered_string_view{"1"}).size() == 4097);
+        auto const second = scope.stop();
+        CHECK(first.values == second.values);
+    }
+}
+
+TEST_CASE("SIMD DISPATCH") {
+    namespace simd = fsv::detail::simd;
+
+    SECTION("level names round-trip") {
+        for (auto i = std::size_t{0}; i < simd::level_count; ++i) {
+            auto const lvl = static_cast<simd::level>(i);
+            CHECK(simd::parse_level(simd::level_name(lvl)) == lvl);
+        }
+        CHECK_FALSE(simd::parse_level("sse9").has_value());
+        CHECK(simd::active_level() <= simd::best_level());
+    }
+
+    SECTION("every supported level agrees with a character-by-character scan") {
+        auto const original = simd::active_level();
+        auto text = std::string(300, '\0');
+        for (auto i = std::size_t{0}; i < text.size(); ++i) {
+            text[i] = static_cast<char>((i * 131 + i / 7) % 256);
+        }
+        auto const classes = {fsv::char_class::digit(),
+                              ~fsv::char_class::alpha(),
+                              fsv::char_class::range('\x80', '\xff')};
+        for (auto i = std::size_t{0}; i < simd::level_count; ++i) {
+            auto const lvl = static_cast<simd::level>(i);
+            if (!simd::set_level(lvl)) {
+                CHECK(lvl > simd::best_level());
+                continue;
+            }
+            CHECK(simd::active_level() == lvl);
+            for (auto const& cls : classes) {
+                for (auto length : {0UL, 1UL, 63UL, 64UL, 65UL, 200UL, 300UL}) {
+                    auto expected = std::string{};
+                    for (auto j = std::size_t{0}; j < length; ++j) {
+                        if (cls.contains(text[j])) {
+                            expected += text[j];
+                        }
+                    }
+                    auto const first = text.data();
+                    CHECK(simd::count(cls, first, length) == expected.size());
+                    auto out = std::string(length + 64, '\0');
+                    out.resize(simd::compact(cls, first, length, out.data(), length));
+                    CHECK(out == expected);
+                    auto runs = std::string{};
+                    auto const append = [&](const char* run, std::size_t n) { runs.append(run, n); };
+                    simd::for_each_run(cls, first, length, append);
+                    CHECK(runs == expected);
+                    auto const found = simd::find_first(cls, first, length);
+                    CHECK((found == length || cls.contains(text[found])));
+                    CHECK(std::none_of(first, first + found, [&](char c) { return cls.contains(c); }));
+                }
+            }
+        }
+        simd::set_level(original);
+    }
+}
@@ -0,0 +1,185 @@
+#include "./predicate_node.h"
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace fsv::detail {
+    predicate_node::predicate_node(filter pred, std::unique_ptr<const rank_select_index> idx)
+    : function(std::move(pred))
+    , table(function.target<char_class>())
+    , identity(function.target<accept_all>() != nullptr || (table != nullptr && *table == char_class::all()))
+    , index(std::move(idx)) {}
+
+    /**
+        predicate registry
+    */
+    predicate_node** predicate_registry::chunks_[std::size_t{1} << (32 - chunk_bits)] = {};
+
+    namespace {
+        // ids move between a thread's cache and the shared free list this many at a time
+        constexpr std::size_t id_batch = 64;
+
+        struct registry_state {
+            std::mutex mutex;
+            // has room for every id ever handed out, so ids can be given back without allocating
+            std::vector<std::uint32_t> free_ids;
+            std::uint32_t next_id = predicate_registry::identity + 1;
+        };
+
+        auto registry() -> registry_state& {
+            static auto state = registry_state{};
+            return state;
+        }
+
+        // returns ids to the shared free list
+        auto give_back(const std::uint32_t* ids, std::size_t count) noexcept -> void {
+            auto& state = registry();
+            auto const lock = std::lock_guard{state.mutex};
+            state.free_ids.insert(state.free_ids.end(), ids, ids + count);
+        }
+
+        /**
+            Ids this thread can hand out and take back without locking. It is refilled and drained
+            id_batch ids at a time, so the mutex is taken once every few dozen inserts or erases.
+        */
+        struct id_cache {
+            id_cache() = default;
+            id_cache(const id_cache&) = delete;
+            auto operator=(const id_cache&) -> id_cache& = delete;
+            ~id_cache();
+
+            std::uint32_t ids[2 * id_batch] = {};
+            std::size_t count = 0;
+        };
+
+        // set once this thread's cache has been flushed; views released later use the free list
+        thread_local auto cache_retired = false;
+        thread_local auto cache = id_cache{};
+
+        id_cache::~id_cache() {
+            cache_retired = true;
+            give_back(ids, count);
+        }
+    } // namespace
+
+    auto predicate_registry::take(std::uint32_t* ids, std::size_t count) -> std::size_t {
+        auto& state = registry();
+        auto const lock = std::lock_guard{state.mutex};
+        if (!state.free_ids.empty()) {
+            auto const taken = std::min(count, state.free_ids.size());
+            auto const first = state.free_ids.end() - static_cast<std::ptrdiff_t>(taken);
+            std::copy(first, state.free_ids.end(), ids);
+            state.free_ids.erase(first, state.free_ids.end());
+            return taken;
+        }
+        if (std::numeric_limits<std::uint32_t>::max() - state.next_id < count) {
+            throw std::length_error{"filtered_string_view: too many live predicates"};
+        }
+        auto const end = std::size_t{state.next_id} + count;
+        if (state.free_ids.capacity() < end) {
+            state.free_ids.reserve(2 * end);
+        }
+        for (auto chunk = std::size_t{state.next_id} >> chunk_bits; chunk <= (end - 1) >> chunk_bits; ++chunk) {
+            if (chunks_[chunk] == nullptr) {
+                chunks_[chunk] = new predicate_node*[std::size_t{chunk_mask} + 1]();
+            }
+        }
+        for (auto i = std::size_t{0}; i < count; ++i) {
+            ids[i] = state.next_id++;
+        }
+        return count;
+    }
+
+    auto predicate_registry::insert(predicate_node* node) -> std::uint32_t {
+        auto id = std::uint32_t{0};
+        if (cache_retired) {
+            take(&id, 1);
+        }
+        else {
+            if (cache.count == 0) {
+                cache.count = take(cache.ids, id_batch);
+            }
+            id = cache.ids[--cache.count];
+        }
+        chunks_[id >> chunk_bits][id & chunk_mask] = node;
+        return id;
+    }
+
+    auto predicate_registry::erase(std::uint32_t id) noexcept -> void {
+        chunks_[id >> chunk_bits][id & chunk_mask] = nullptr;
+        if (cache_retired) {
+            give_back(&id, 1);
+            return;
+        }
+        if (cache.count == std::size(cache.ids)) {
+            cache.count -= id_batch;
+            give_back(cache.ids + cache.count, id_batch);
+        }
+        cache.ids[cache.count++] = id;
+    }
+
+    /**
+        shared_predicate
+    */
+    shared_predicate::shared_predicate(filter pred) {
+        if (pred.target<accept_all>() == nullptr) {
+            auto node = std::make_unique<predicate_node>(std::move(pred));
+            id_ = predicate_registry::insert(node.get());
+            node.release();
+        }
+    }
+
+    shared_predicate::shared_predicate(filter pred, std::unique_ptr<const rank_select_index> index) {
+        auto node = std::make_unique<predicate_node>(std::move(pred), std::move(index));
+        id_ = predicate_registry::insert(node.get());
+        node.release();
+    }
+
+    shared_predicate::shared_predicate(const shared_predicate& other) noexcept
+    : id_(other.id_) {
+        retain();
+    }
+
+    shared_predicate::shared_predicate(shared_predicate&& other) noexcept
+    : id_(std::exchange(other.id_, predicate_registry::identity)) {}
+
+    shared_predicate::~shared_predicate() noexcept {
+        release();
+    }
+
+    auto shared_predicate::operator=(const shared_predicate& other) noexcept -> shared_predicate& {
+        other.retain();
+        release();
+        id_ = other.id_;
+        return *this;
+    }
+
+    auto shared_predicate::operator=(shared_predicate&& other) noexcept -> shared_predicate& {
+        if (this != &other) {
+            release();
+            id_ = std::exchange(other.id_, predicate_registry::identity);
+        }
+        return *this;
+    }
+
+    auto shared_predicate::retain() const noexcept -> void {
+        if (id_ != predicate_registry::identity) {
+            predicate_registry::find(id_)->references.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    auto shared_predicate::release() const noexcept -> void {
+        if (id_ == predicate_registry::identity) {
+            return;
+        }
+        auto const node = predicate_registry::find(id_);
+        if (node->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            predicate_registry::erase(id_);
+            delete node;
+        }
+    }
+} // namespace fsv::detail
@@ -0,0 +1,121 @@
+#ifndef COMP6771_ASS2_PREDICATE_NODE_H
+#define COMP6771_ASS2_PREDICATE_NODE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "./char_class.h"
+#include "./rank_select_index.h"
+
+namespace fsv {
+    using filter = std::function<bool(const char&)>;
+
+#if defined(FSV_COUNT_PREDICATE_CALLS)
+    // calls of stored predicates made by filtered_string_view since the program started
+    inline std::atomic<std::uint64_t> predicate_calls = 0;
+#endif
+
+    namespace detail {
+        struct accept_all {
+            constexpr auto operator()(const char&) const noexcept -> bool {
+                return true;
+            }
+        };
+
+        /**
+            Immutable predicate shared by every view copied, moved or sliced from the view that
+            created it, with what the view needs to pick its fast paths worked out once.
+        */
+        struct predicate_node {
+            explicit predicate_node(filter pred, std::unique_ptr<const rank_select_index> idx = nullptr);
+
+            auto operator()(const char& c) const -> bool {
+#if defined(FSV_COUNT_PREDICATE_CALLS)
+                predicate_calls.fetch_add(1, std::memory_order_relaxed);
+#endif
+                return function(c);
+            }
+
+            filter function;
+            // set when function holds a char_class, enabling the table-driven kernels
+            const char_class* table;
+            // set when function accepts every character, so views behave as plain string_views
+            bool identity;
+            // covers [data(), raw() + length) of the view that built it, and so every slice of it
+            std::unique_ptr<const rank_select_index> index;
+            mutable std::atomic<std::size_t> references = 1;
+        };
+
+        /**
+            Maps the 32-bit ids that views store to predicate nodes. Id 0 is the shared identity
+            node, which always exists and is not counted. Slots live in chunks that are allocated
+            on first use and never move, so lookups need no lock. Each thread caches a batch of
+            free ids, so inserts and erases take the registry mutex only to move a batch.
+        */
+        class predicate_registry {
+        public:
+            static constexpr std::uint32_t identity = 0;
+
+            static auto insert(predicate_node* node) -> std::uint32_t;
+            static auto erase(std::uint32_t id) noexcept -> void;
+
+            static auto find(std::uint32_t id) noexcept -> const predicate_node* {
+                if (id == identity) {
+                    return identity_node();
+                }
+                return chunks_[id >> chunk_bits][id & chunk_mask];
+            }
+
+        private:
+            static constexpr std::uint32_t chunk_bits = 16;
+            static constexpr std::uint32_t chunk_mask = (std::uint32_t{1} << chunk_bits) - 1;
+
+            // moves up to count free ids into ids, minting new ones when none are free
+            static auto take(std::uint32_t* ids, std::size_t count) -> std::size_t;
+
+            static auto identity_node() noexcept -> const predicate_node* {
+                static auto const node = predicate_node{accept_all{}};
+                return &node;
+            }
+
+            static predicate_node** chunks_[std::size_t{1} << (32 - chunk_bits)];
+        };
+
+        /**
+            Intrusively reference-counted handle to a registered predicate_node. Copying and
+            moving never allocate; only constructing from a filter that is not the identity does.
+        */
+        class shared_predicate {
+        public:
+            // the shared identity node
+            shared_predicate() noexcept = default;
+            explicit shared_predicate(filter pred);
+            shared_predicate(filter pred, std::unique_ptr<const rank_select_index> index);
+
+            shared_predicate(const shared_predicate& other) noexcept;
+            shared_predicate(shared_predicate&& other) noexcept;
+            ~shared_predicate() noexcept;
+
+            auto operator=(const shared_predicate& other) noexcept -> shared_predicate&;
+            auto operator=(shared_predicate&& other) noexcept -> shared_predicate&;
+
+            auto operator->() const noexcept -> const predicate_node* {
+                return predicate_registry::find(id_);
+            }
+            auto operator*() const noexcept -> const predicate_node& {
+                return *predicate_registry::find(id_);
+            }
+
+        private:
+            auto retain() const noexcept -> void;
+            auto release() const noexcept -> void;
+
+            std::uint32_t id_ = predicate_registry::identity;
+        };
+    } // namespace detail
+} // namespace fsv
+
+#endif // COMP6771_ASS2_PREDICATE_NODE_H
@@ -0,0 +1,120 @@
+#include "./profile_scope.h"
+
+#if defined(__linux__)
+#    include <cstring>
+#    include <linux/perf_event.h>
+#    include <sys/ioctl.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#endif
+
+namespace fsv {
+#if defined(__linux__)
+    namespace {
+        struct event {
+            std::uint32_t type;
+            std::uint64_t config;
+        };
+
+        constexpr auto cache_miss(std::uint64_t cache) -> std::uint64_t {
+            return cache | (std::uint64_t{PERF_COUNT_HW_CACHE_OP_READ} << 8)
+                   | (std::uint64_t{PERF_COUNT_HW_CACHE_RESULT_MISS} << 16);
+        }
+
+        // in the order of hardware_counter
+        constexpr auto events = std::array<event, hardware_counter_count>{{
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D)},
+            {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL)},
+        }};
+
+        // each counter is its own group, so one the PMU lacks cannot keep the others from opening
+        auto open(const event& e) noexcept -> int {
+            auto attr = perf_event_attr{};
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = e.type;
+            attr.config = e.config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+
+        // scaled up when the kernel had to multiplex the counter with others
+        auto read_scaled(int fd) noexcept -> std::optional<std::uint64_t> {
+            std::uint64_t values[3] = {};
+            if (read(fd, values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)) || values[2] == 0) {
+                return std::nullopt;
+            }
+            if (values[1] == values[2]) {
+                return values[0];
+            }
+            return static_cast<std::uint64_t>(static_cast<double>(values[0]) * static_cast<double>(values[1])
+                                              / static_cast<double>(values[2]));
+        }
+    } // namespace
+
+    profile_scope::profile_scope() {
+        for (auto i = std::size_t{0}; i < hardware_counter_count; ++i) {
+            fds_[i] = open(events[i]);
+        }
+        for (auto fd : fds_) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    profile_scope::~profile_scope() noexcept {
+        for (auto fd : fds_) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    auto profile_scope::stop() -> profile_counts {
+        if (result_) {
+            return *result_;
+        }
+        for (auto fd : fds_) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+        auto counts = profile_counts{};
+        for (auto i = std::size_t{0}; i < hardware_counter_count; ++i) {
+            if (fds_[i] >= 0) {
+                counts.values[i] = read_scaled(fds_[i]);
+            }
+        }
+        result_ = counts;
+        return counts;
+    }
+#else
+    profile_scope::profile_scope() {
+        fds_.fill(-1);
+    }
+
+    profile_scope::~profile_scope() noexcept = default;
+
+    auto profile_scope::stop() -> profile_counts {
+        result_ = profile_counts{};
+        return *result_;
+    }
+#endif
+
+    auto profile_scope::available() const noexcept -> bool {
+        for (auto fd : fds_) {
+            if (fd >= 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+} // namespace fsv
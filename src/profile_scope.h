@@ -0,0 +1,51 @@
+#ifndef COMP6771_ASS2_PROFILE_SCOPE_H
+#define COMP6771_ASS2_PROFILE_SCOPE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace fsv {
+    enum class hardware_counter { cycles, instructions, branch_misses, l1d_misses, llc_misses };
+
+    inline constexpr auto hardware_counter_count = std::size_t{5};
+
+    /**
+        Counts of the user-space events between the start and end of a profile_scope. A counter is
+        empty when the kernel or hardware does not provide it.
+    */
+    struct profile_counts {
+        std::array<std::optional<std::uint64_t>, hardware_counter_count> values;
+
+        auto operator[](hardware_counter counter) const noexcept -> const std::optional<std::uint64_t>& {
+            return values[static_cast<std::size_t>(counter)];
+        }
+    };
+
+    /**
+        Reads hardware performance counters for the calling thread through Linux perf_event_open
+        from construction until stop(). Elsewhere, or when the counters cannot be opened (no PMU in
+        a virtual machine, perf_event_paranoid above 2, a seccomp filter), the scope is inert and
+        every count is empty, so profiled code runs unchanged.
+    */
+    class profile_scope {
+    public:
+        profile_scope();
+        ~profile_scope() noexcept;
+
+        profile_scope(const profile_scope&) = delete;
+        auto operator=(const profile_scope&) -> profile_scope& = delete;
+
+        // stops counting and returns the counts; later calls return the same counts
+        auto stop() -> profile_counts;
+        // true when at least one counter could be opened
+        auto available() const noexcept -> bool;
+
+    private:
+        std::array<int, hardware_counter_count> fds_;
+        std::optional<profile_counts> result_;
+    };
+} // namespace fsv
+
+#endif // COMP6771_ASS2_PROFILE_SCOPE_H
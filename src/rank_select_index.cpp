@@ -0,0 +1,51 @@
+#include "./rank_select_index.h"
+#include <algorithm>
+#include <bit>
+
+namespace fsv::detail {
+    rank_select_index::rank_select_index(std::vector<std::uint64_t> words, std::size_t length)
+    : words_(std::move(words))
+    , blocks_((words_.size() + block_words - 1) / block_words + 1)
+    , length_(length)
+    , ones_(0) {
+        for (auto w = std::size_t{0}; w < words_.size(); ++w) {
+            if (w % block_words == 0) {
+                blocks_[w / block_words] = ones_;
+            }
+            ones_ += static_cast<std::size_t>(std::popcount(words_[w]));
+        }
+        blocks_.back() = ones_;
+    }
+
+    auto rank_select_index::rank(std::size_t i) const noexcept -> std::size_t {
+        auto const word = i / word_bits;
+        auto result = blocks_[word / block_words];
+        for (auto w = word - word % block_words; w < word; ++w) {
+            result += static_cast<std::size_t>(std::popcount(words_[w]));
+        }
+        if (auto const bit = i % word_bits; bit != 0) {
+            auto const below = (std::uint64_t{1} << bit) - 1;
+            result += static_cast<std::size_t>(std::popcount(words_[word] & below));
+        }
+        return result;
+    }
+
+    auto rank_select_index::select(std::size_t k) const noexcept -> std::size_t {
+        // the last block whose sampled rank is still <= k holds the answer
+        auto const block = std::upper_bound(blocks_.begin(), blocks_.end(), k) - blocks_.begin() - 1;
+        auto remaining = k - blocks_[static_cast<std::size_t>(block)];
+        auto w = static_cast<std::size_t>(block) * block_words;
+        for (;; ++w) {
+            auto const count = static_cast<std::size_t>(std::popcount(words_[w]));
+            if (remaining < count) {
+                break;
+            }
+            remaining -= count;
+        }
+        auto bits = words_[w];
+        for (; remaining > 0; --remaining) {
+            bits &= bits - 1;
+        }
+        return w * word_bits + static_cast<std::size_t>(std::countr_zero(bits));
+    }
+} // namespace fsv::detail
@@ -0,0 +1,57 @@
+#ifndef COMP6771_ASS2_RANK_SELECT_INDEX_H
+#define COMP6771_ASS2_RANK_SELECT_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fsv::detail {
+    /**
+        Succinct rank/select structure over the predicate results of a raw character range.
+        Bit i is set when the predicate accepts character i. Every block of 512 bits samples
+        the number of accepted characters before it, so rank is O(1) and select is O(log n).
+    */
+    class rank_select_index {
+    public:
+        static constexpr std::size_t word_bits = 64;
+        static constexpr std::size_t block_words = 8;
+        static constexpr std::size_t block_bits = word_bits * block_words;
+
+        rank_select_index(std::vector<std::uint64_t> words, std::size_t length);
+
+        template<typename Pred>
+        static auto build(const char* first, std::size_t length, const Pred& pred) -> rank_select_index {
+            auto words = std::vector<std::uint64_t>((length + word_bits - 1) / word_bits);
+            for (auto i = std::size_t{0}; i < length; ++i) {
+                if (pred(first[i])) {
+                    words[i / word_bits] |= std::uint64_t{1} << (i % word_bits);
+                }
+            }
+            return rank_select_index{std::move(words), length};
+        }
+
+        auto length() const noexcept -> std::size_t {
+            return length_;
+        }
+        auto ones() const noexcept -> std::size_t {
+            return ones_;
+        }
+
+        auto test(std::size_t i) const noexcept -> bool {
+            return (words_[i / word_bits] >> (i % word_bits)) & 1U;
+        }
+
+        // number of accepted characters in [0, i)
+        auto rank(std::size_t i) const noexcept -> std::size_t;
+        // raw position of the k-th accepted character; requires k < ones()
+        auto select(std::size_t k) const noexcept -> std::size_t;
+
+    private:
+        std::vector<std::uint64_t> words_;
+        std::vector<std::size_t> blocks_;
+        std::size_t length_;
+        std::size_t ones_;
+    };
+} // namespace fsv::detail
+
+#endif // COMP6771_ASS2_RANK_SELECT_INDEX_H
@@ -0,0 +1,276 @@
+#include "./simd.h"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(__i386__)
+#    define FSV_SIMD_X86 1
+#    include <immintrin.h>
+#endif
+
+namespace fsv::detail::simd {
+    namespace {
+        // PSHUFB controls that move the bytes selected by an 8-bit mask to the front of an 8-byte group
+        constexpr auto compaction_shuffles = [] {
+            auto table = std::array<std::array<std::uint8_t, 8>, 256>{};
+            for (auto mask = std::size_t{0}; mask < table.size(); ++mask) {
+                auto n = std::size_t{0};
+                for (auto bit = std::uint8_t{0}; bit < 8; ++bit) {
+                    if ((mask >> bit) & 1U) {
+                        table[mask][n++] = bit;
+                    }
+                }
+            }
+            return table;
+        }();
+
+        namespace scalar {
+#define FSV_SIMD_TARGET
+            inline auto mask64(const char_class& cls, const char* first) -> std::uint64_t {
+                auto mask = std::uint64_t{0};
+                for (auto i = 0U; i < 64; ++i) {
+                    mask |= static_cast<std::uint64_t>(cls.contains(first[i])) << i;
+                }
+                return mask;
+            }
+
+            inline auto compact64(const char* block, std::uint64_t mask, char* out) -> std::size_t {
+                auto n = std::size_t{0};
+                for (; mask != 0; mask &= mask - 1) {
+                    out[n++] = block[std::countr_zero(mask)];
+                }
+                return n;
+            }
+#include "./simd_kernels.inc"
+#undef FSV_SIMD_TARGET
+        } // namespace scalar
+
+#if defined(FSV_SIMD_X86)
+        // Table lookups by nibble: the low nibble picks a row of the table with PSHUFB, the high
+        // nibble picks the bit within that row.
+        namespace ssse3 {
+#    define FSV_SIMD_TARGET __attribute__((target("ssse3,popcnt")))
+            FSV_SIMD_TARGET inline auto mask64(const char_class& cls, const char* first) -> std::uint64_t {
+                auto const rows = cls.rows().data();
+                auto const low_rows = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows));
+                auto const high_rows = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + 16));
+                auto const bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+                auto const nibble = _mm_set1_epi8(0x0F);
+                auto const seven = _mm_set1_epi8(7);
+                auto mask = std::uint64_t{0};
+                for (auto k = 0U; k < 4; ++k) {
+                    auto const v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + 16 * k));
+                    auto const lo = _mm_and_si128(v, nibble);
+                    auto const hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+                    auto const upper = _mm_cmpgt_epi8(hi, seven);
+                    auto const row = _mm_or_si128(_mm_andnot_si128(upper, _mm_shuffle_epi8(low_rows, lo)),
+                                                  _mm_and_si128(upper, _mm_shuffle_epi8(high_rows, lo)));
+                    auto const bit = _mm_shuffle_epi8(bits, hi);
+                    auto const hit = _mm_cmpeq_epi8(_mm_and_si128(row, bit), bit);
+                    mask |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(hit))) << (16 * k);
+                }
+                return mask;
+            }
+
+            // compaction by 8-byte groups: one PSHUFB per group, then advance by its popcount
+            FSV_SIMD_TARGET inline auto compact64(const char* block, std::uint64_t mask, char* out) -> std::size_t {
+                auto n = std::size_t{0};
+                for (auto group = 0U; group < 8; ++group, mask >>= 8) {
+                    auto const bits = static_cast<std::size_t>(mask & 0xFFU);
+                    auto const v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(block + 8 * group));
+                    auto const shuffle = compaction_shuffles[bits].data();
+                    auto const control = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(shuffle));
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + n), _mm_shuffle_epi8(v, control));
+                    n += static_cast<std::size_t>(std::popcount(bits));
+                }
+                return n;
+            }
+#    include "./simd_kernels.inc"
+#    undef FSV_SIMD_TARGET
+        } // namespace ssse3
+
+        namespace avx2 {
+#    define FSV_SIMD_TARGET __attribute__((target("avx2,popcnt")))
+            FSV_SIMD_TARGET inline auto mask64(const char_class& cls, const char* first) -> std::uint64_t {
+                auto const rows = cls.rows().data();
+                auto const low_rows =
+                    _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows)));
+                auto const high_rows =
+                    _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + 16)));
+                auto const bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                                   1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+                auto const nibble = _mm256_set1_epi8(0x0F);
+                auto const seven = _mm256_set1_epi8(7);
+                auto mask = std::uint64_t{0};
+                for (auto k = 0U; k < 2; ++k) {
+                    auto const v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + 32 * k));
+                    auto const lo = _mm256_and_si256(v, nibble);
+                    auto const hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+                    auto const row = _mm256_blendv_epi8(_mm256_shuffle_epi8(low_rows, lo),
+                                                        _mm256_shuffle_epi8(high_rows, lo),
+                                                        _mm256_cmpgt_epi8(hi, seven));
+                    auto const bit = _mm256_shuffle_epi8(bits, hi);
+                    auto const hit = _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit);
+                    mask |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(hit)))
+                            << (32 * k);
+                }
+                return mask;
+            }
+
+            // AVX2 has no lane-crossing byte shuffle, so compaction stays on the 8-byte PSHUFB groups;
+            // avx2 implies ssse3, so the SSSE3 helper still inlines here
+            using ssse3::compact64;
+#    include "./simd_kernels.inc"
+#    undef FSV_SIMD_TARGET
+        } // namespace avx2
+
+        // AVX-512BW does the nibble lookup for a whole block at once and yields the mask directly;
+        // VBMI2 compacts a block with one VPCOMPRESSB.
+        namespace avx512 {
+#    define FSV_SIMD_TARGET __attribute__((target("avx512f,avx512bw,avx512vbmi2,popcnt")))
+            // the zero-masked broadcast, because GCC 12 warns about the undefined source of the plain one
+            FSV_SIMD_TARGET inline auto broadcast(__m128i v) -> __m512i {
+                return _mm512_maskz_broadcast_i32x4(0xFFFF, v);
+            }
+
+            FSV_SIMD_TARGET inline auto mask64(const char_class& cls, const char* first) -> std::uint64_t {
+                auto const rows = cls.rows().data();
+                auto const low_rows = broadcast(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows)));
+                auto const high_rows = broadcast(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + 16)));
+                auto const bits = broadcast(_mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128));
+                auto const nibble = _mm512_set1_epi8(0x0F);
+                auto const v = _mm512_loadu_si512(first);
+                auto const lo = _mm512_and_si512(v, nibble);
+                auto const hi = _mm512_and_si512(_mm512_srli_epi16(v, 4), nibble);
+                auto const upper = _mm512_cmpgt_epi8_mask(hi, _mm512_set1_epi8(7));
+                auto const row = _mm512_mask_shuffle_epi8(_mm512_shuffle_epi8(low_rows, lo), upper, high_rows, lo);
+                return _mm512_test_epi8_mask(row, _mm512_shuffle_epi8(bits, hi));
+            }
+
+            FSV_SIMD_TARGET inline auto compact64(const char* block, std::uint64_t mask, char* out) -> std::size_t {
+                _mm512_storeu_si512(out, _mm512_maskz_compress_epi8(mask, _mm512_loadu_si512(block)));
+                return static_cast<std::size_t>(std::popcount(mask));
+            }
+#    include "./simd_kernels.inc"
+#    undef FSV_SIMD_TARGET
+        } // namespace avx512
+#endif
+
+        struct kernel_table {
+            decltype(&scalar::count) count;
+            decltype(&scalar::find_first) find_first;
+            decltype(&scalar::find_last) find_last;
+            decltype(&scalar::runs) runs;
+            decltype(&scalar::compact) compact;
+        };
+
+#define FSV_SIMD_KERNELS(isa) kernel_table{isa::count, isa::find_first, isa::find_last, isa::runs, isa::compact}
+        // indexed by level; levels the target cannot compile fall back to the scalar kernels
+        constexpr auto tables = std::array<kernel_table, level_count>{
+            FSV_SIMD_KERNELS(scalar),
+#if defined(FSV_SIMD_X86)
+            FSV_SIMD_KERNELS(ssse3),
+            FSV_SIMD_KERNELS(avx2),
+            FSV_SIMD_KERNELS(avx512),
+#else
+            FSV_SIMD_KERNELS(scalar),
+            FSV_SIMD_KERNELS(scalar),
+            FSV_SIMD_KERNELS(scalar),
+#endif
+        };
+#undef FSV_SIMD_KERNELS
+
+        auto detect() noexcept -> level {
+#if defined(FSV_SIMD_X86)
+            __builtin_cpu_init();
+            if (!__builtin_cpu_supports("popcnt")) {
+                return level::scalar;
+            }
+            if (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vbmi2")) {
+                return level::avx512;
+            }
+            if (__builtin_cpu_supports("avx2")) {
+                return level::avx2;
+            }
+            if (__builtin_cpu_supports("ssse3")) {
+                return level::ssse3;
+            }
+#endif
+            return level::scalar;
+        }
+
+        // FSV_SIMD can lower the level for testing; naming a level the CPU lacks leaves the best one
+        auto initial_level() noexcept -> level {
+            auto const best = best_level();
+            if (auto const name = std::getenv("FSV_SIMD")) {
+                if (auto const requested = parse_level(name); requested && *requested <= best) {
+                    return *requested;
+                }
+            }
+            return best;
+        }
+
+        auto active() noexcept -> std::atomic<const kernel_table*>& {
+            static auto table = std::atomic<const kernel_table*>{&tables[static_cast<std::size_t>(initial_level())]};
+            return table;
+        }
+
+        auto kernels() noexcept -> const kernel_table& {
+            return *active().load(std::memory_order_relaxed);
+        }
+    } // namespace
+
+    auto best_level() noexcept -> level {
+        static auto const best = detect();
+        return best;
+    }
+
+    auto active_level() noexcept -> level {
+        return static_cast<level>(active().load(std::memory_order_relaxed) - tables.data());
+    }
+
+    auto set_level(level lvl) noexcept -> bool {
+        if (lvl > best_level()) {
+            return false;
+        }
+        active().store(&tables[static_cast<std::size_t>(lvl)], std::memory_order_relaxed);
+        return true;
+    }
+
+    auto parse_level(std::string_view name) noexcept -> std::optional<level> {
+        for (auto i = std::size_t{0}; i < level_count; ++i) {
+            if (name == level_name(static_cast<level>(i))) {
+                return static_cast<level>(i);
+            }
+        }
+        return std::nullopt;
+    }
+
+    auto level_name(level lvl) noexcept -> const char* {
+        constexpr const char* names[level_count] = {"scalar", "ssse3", "avx2", "avx512"};
+        return names[static_cast<std::size_t>(lvl)];
+    }
+
+    auto count(const char_class& cls, const char* first, std::size_t length) -> std::size_t {
+        return kernels().count(cls, first, length);
+    }
+
+    auto find_first(const char_class& cls, const char* first, std::size_t length) -> std::size_t {
+        return kernels().find_first(cls, first, length);
+    }
+
+    auto find_last(const char_class& cls, const char* first, std::size_t length) -> std::size_t {
+        return kernels().find_last(cls, first, length);
+    }
+
+    auto compact(const char_class& cls, const char* first, std::size_t length, char* out, std::size_t capacity)
+        -> std::size_t {
+        return kernels().compact(cls, first, length, out, capacity);
+    }
+
+    auto runs(const char_class& cls, const char* first, std::size_t length, run_sink sink, void* context) -> void {
+        kernels().runs(cls, first, length, sink, context);
+    }
+} // namespace fsv::detail::simd
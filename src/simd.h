@@ -0,0 +1,56 @@
+#ifndef COMP6771_ASS2_SIMD_H
+#define COMP6771_ASS2_SIMD_H
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+
+#include "./char_class.h"
+
+namespace fsv::detail::simd {
+    using run_sink = void (*)(void* context, const char* first, std::size_t length);
+
+    /**
+        Instruction sets the kernels are built for, in increasing order. The level is chosen once,
+        on first use, as the best the CPU supports; setting the environment variable FSV_SIMD to a
+        level name (scalar, ssse3, avx2, avx512) lowers it, which lets one machine test every path.
+    */
+    enum class level { scalar, ssse3, avx2, avx512 };
+
+    inline constexpr auto level_count = std::size_t{4};
+
+    // the best level this CPU supports
+    auto best_level() noexcept -> level;
+    // the level the kernels currently run at
+    auto active_level() noexcept -> level;
+    // switches every kernel to lvl; returns false and changes nothing when the CPU does not support it
+    auto set_level(level lvl) noexcept -> bool;
+    auto parse_level(std::string_view name) noexcept -> std::optional<level>;
+    auto level_name(level lvl) noexcept -> const char*;
+
+    // number of characters in [first, first + length) that belong to cls
+    auto count(const char_class& cls, const char* first, std::size_t length) -> std::size_t;
+    // offset of the first character in cls, or length if there is none
+    auto find_first(const char_class& cls, const char* first, std::size_t length) -> std::size_t;
+    // offset of the last character in cls, or length if there is none
+    auto find_last(const char_class& cls, const char* first, std::size_t length) -> std::size_t;
+    // copies the characters in cls to out, stopping after capacity of them; returns how many were copied
+    auto compact(const char_class& cls, const char* first, std::size_t length, char* out, std::size_t capacity)
+        -> std::size_t;
+    // calls sink once per maximal run of consecutive characters in cls, in order
+    auto runs(const char_class& cls, const char* first, std::size_t length, run_sink sink, void* context) -> void;
+
+    template<typename F>
+    auto for_each_run(const char_class& cls, const char* first, std::size_t length, F&& f) -> void {
+        using callable = std::remove_reference_t<F>;
+        runs(
+            cls,
+            first,
+            length,
+            [](void* context, const char* run, std::size_t n) { (*static_cast<callable*>(context))(run, n); },
+            const_cast<void*>(static_cast<const void*>(&f)));
+    }
+} // namespace fsv::detail::simd
+
+#endif // COMP6771_ASS2_SIMD_H